@@ -0,0 +1,86 @@
+// Canny edge detection on a large synthetic scan, to compare the allocation policies of utils/memory.h:
+//
+//   CVUI_HUGE_PAGE_THRESHOLD=0 ./canny_benchmark   # 4 KiB pages only
+//   ./canny_benchmark                              # huge pages above the default threshold
+//   CVUI_PREFAULT=1 ./canny_benchmark              # huge pages, faulted in at allocation time
+//
+// Usage: canny_benchmark [rows cols [runs]]. The buffer pool is disabled so that every run allocates and faults its
+// intermediates, like the first run on a new scan.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "image_processing/canny.h"
+#include "utils/matrix.h"
+#include "utils/memory.h"
+
+namespace {
+// Rings, rectangles and a bit of noise, the same for every run and every policy
+std::shared_ptr<Matrix<uint8_t>> make_scan(size_t rows, size_t cols)
+{
+  auto img = std::make_shared<Matrix<uint8_t>>(rows, cols);
+  uint32_t seed = 12345;
+  for (size_t row = 0; row < rows; ++row) {
+    uint8_t* img_row = img->row_ptr(row);
+    for (size_t col = 0; col < cols; ++col) {
+      float dx = float(col) - 0.5f * float(cols), dy = float(row) - 0.5f * float(rows);
+      float value = 128.f + 60.f * std::sin(std::sqrt(dx * dx + dy * dy) * 0.02f);
+      if ((row / 300 + col / 400) % 3 == 0) {
+        value += 50.f;
+      }
+      seed = seed * 1664525u + 1013904223u;
+      value += float(seed >> 28) - 8.f;
+      img_row[col] = uint8_t(std::min(std::max(value, 0.f), 255.f));
+    }
+  }
+  return img;
+}
+}
+
+int main(int argc, char** argv)
+{
+  size_t rows = argc > 2 ? size_t(std::atol(argv[1])) : 8000;
+  size_t cols = argc > 2 ? size_t(std::atol(argv[2])) : 8000;
+  int runs = argc > 3 ? std::max(std::atoi(argv[3]), 1) : 5;
+
+  utils::set_buffer_pool_capacity(0);
+  utils::AllocationPolicy policy = utils::get_allocation_policy();
+  printf("%zux%zu, huge page threshold %zu bytes, prefault %s\n",
+         rows,
+         cols,
+         policy.huge_page_threshold,
+         policy.prefault ? "on" : "off");
+
+  auto scan = make_scan(rows, cols);
+  std::vector<double> timings;
+  size_t edges = 0;
+  for (int run = 0; run < runs; ++run) {
+    CannyEdgeDetector canny_edge_detector(10.f, 30.f);
+    auto start = std::chrono::steady_clock::now();
+    canny_edge_detector.process_gray_img(scan);
+    timings.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    // Same output whatever the policy
+    auto canny_edges = canny_edge_detector.get_canny_edges();
+    edges = 0;
+    for (size_t row = 0; row < canny_edges->get_rows(); ++row) {
+      const uint8_t* edges_row = canny_edges->row_ptr(row);
+      edges += size_t(std::count_if(edges_row, edges_row + canny_edges->get_cols(), [](uint8_t v) { return v != 0; }));
+    }
+  }
+
+  std::sort(timings.begin(), timings.end());
+  printf("%d runs: min %.1f ms, median %.1f ms, max %.1f ms (%zu edge pixels)\n",
+         runs,
+         timings.front(),
+         timings[timings.size() / 2],
+         timings.back(),
+         edges);
+  return 0;
+}
\ No newline at end of file
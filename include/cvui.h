@@ -109,6 +109,9 @@ private:
   BorderProcessor border_processor;
   NormalizationProcessor normalization_processor;
   GaussianBlurProcessor gaussian_blur_processor;
+  BoxFilterProcessor box_filter_processor;
+  MedianFilterProcessor median_filter_processor;
+  GuidedFilterProcessor guided_filter_processor;
   EdgeDetectionProcessor edge_detection_processor;
   KMeansProcessor kmeans_processor;
   ColorConversionProcessor color_conversion_processor;
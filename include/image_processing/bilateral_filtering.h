@@ -21,7 +21,7 @@ private:
   int kernel_size;
   NormalDistribution normal_distribution;
 
-  RGBAPixel apply_on_pixel(std::shared_ptr<Matrix<uint32_t>> input_img, size_t row, size_t col);
+  RGBAPixel apply_on_pixel(MatrixView<const uint32_t> input_img, size_t row, size_t col);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef IMAGE_PROCESSING_BOX_FILTER_H
+#define IMAGE_PROCESSING_BOX_FILTER_H
+
+#include <cstdint>
+#include <memory>
+
+#include "image_processing/spatial_filtering.h"
+#include "utils/matrix.h"
+#include "utils/planar_image.h"
+
+namespace ip {
+// Mean over a kernel_size x kernel_size window, the same window as apply_kernel with a constant kernel. Computed with
+// running sums along the rows then along the columns, so the cost per pixel does not depend on the kernel size.
+// 8 and 16 bits inputs are summed with integers (no drift), float inputs with doubles. The CONSTANT border counts
+// the outside pixels as zeros
+template<typename T>
+void box_filter(std::shared_ptr<Matrix<T>> input_img,
+                size_t kernel_size,
+                std::shared_ptr<Matrix<T>> output_img,
+                BorderMode border_mode = BorderMode::CONSTANT);
+template<typename T>
+void box_filter(MatrixView<const T> input_img,
+                size_t kernel_size,
+                MatrixView<T> output_img,
+                BorderMode border_mode = BorderMode::CONSTANT);
+
+// RGB version, alpha is set to 255
+void box_filter(std::shared_ptr<Matrix<uint32_t>> input_img,
+                size_t kernel_size,
+                std::shared_ptr<Matrix<uint32_t>> output_img,
+                BorderMode border_mode = BorderMode::CONSTANT);
+void box_filter(MatrixView<const uint32_t> input_img,
+                size_t kernel_size,
+                MatrixView<uint32_t> output_img,
+                BorderMode border_mode = BorderMode::CONSTANT);
+
+// Planar version, color planes are filtered as gray images and alpha is set to 255
+void box_filter(std::shared_ptr<PlanarImage> input_img,
+                size_t kernel_size,
+                std::shared_ptr<PlanarImage> output_img,
+                BorderMode border_mode = BorderMode::CONSTANT);
+
+// Variance over the same window, E[x^2] - E[x]^2, from the running sums of the values and of their squares
+template<typename T>
+void local_variance(std::shared_ptr<Matrix<T>> input_img,
+                    size_t kernel_size,
+                    std::shared_ptr<Matrix<float>> output_img,
+                    BorderMode border_mode = BorderMode::CONSTANT);
+template<typename T>
+void local_variance(MatrixView<const T> input_img,
+                    size_t kernel_size,
+                    MatrixView<float> output_img,
+                    BorderMode border_mode = BorderMode::CONSTANT);
+
+// RGB version, the variance of every channel is saturated to 8 bits, alpha is set to 255
+void local_variance(std::shared_ptr<Matrix<uint32_t>> input_img,
+                    size_t kernel_size,
+                    std::shared_ptr<Matrix<uint32_t>> output_img,
+                    BorderMode border_mode = BorderMode::CONSTANT);
+void local_variance(MatrixView<const uint32_t> input_img,
+                    size_t kernel_size,
+                    MatrixView<uint32_t> output_img,
+                    BorderMode border_mode = BorderMode::CONSTANT);
+
+// Planar version, the variance of every color plane is saturated to 8 bits, alpha is set to 255
+void local_variance(std::shared_ptr<PlanarImage> input_img,
+                    size_t kernel_size,
+                    std::shared_ptr<PlanarImage> output_img,
+                    BorderMode border_mode = BorderMode::CONSTANT);
+}
+
+#endif
\ No newline at end of file
@@ -23,7 +23,6 @@ private:
   float low_threshold, high_threshold;
 
   // Canny process image
-  std::shared_ptr<Matrix<float>> sobel_h, sobel_v, gaussian_kernel;
   std::shared_ptr<Matrix<uint8_t>> gray_img;
   std::shared_ptr<Matrix<float>> edge_h, edge_v;
   std::shared_ptr<Matrix<float>> edge_magnitude, edge_angle;
@@ -0,0 +1,60 @@
+#ifndef IMAGE_PROCESSING_FFT_CONVOLUTION_H
+#define IMAGE_PROCESSING_FFT_CONVOLUTION_H
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "image_processing/spatial_filtering.h"
+#include "utils/matrix.h"
+
+namespace ip {
+// Radix-2 complex FFT of a power of two size, the bit reversal permutation and the twiddles are precomputed
+class FftPlan
+{
+public:
+  explicit FftPlan(size_t _size);
+  ~FftPlan() = default;
+
+  size_t get_size() const { return size; };
+
+  // In place and unnormalized, the inverse transform of the forward transform multiplies the data by size
+  void transform(std::complex<float>* data, bool inverse) const;
+  // Same on a size x size row major buffer, rows first, then columns
+  void transform_2d(std::complex<float>* data, bool inverse) const;
+
+private:
+  size_t size;
+  std::vector<size_t> bit_reversal;
+  std::vector<std::complex<float>> twiddles;
+};
+
+// The direct correlation costs (kernel rows x kernel cols) taps per pixel, the FFT one roughly a constant. Kernels of
+// at least FFT_KERNEL_AREA_THRESHOLD taps switch to FFTs, separable ones (2 x kernel size taps per pixel) only from
+// FFT_SEPARABLE_KERNEL_SIZE
+const size_t FFT_KERNEL_AREA_THRESHOLD = 400;
+const size_t FFT_SEPARABLE_KERNEL_SIZE = 255;
+bool use_fft_convolution(const Matrix<float>& kernel, bool separable);
+
+// Overlap-save correlation: the image is cut in tiles, each of them goes through a forward FFT, a product with the
+// kernel spectrum and an inverse FFT. Taps outside of the image follow the border mode, as for the direct path, and
+// the results match it up to float rounding. Two real tiles share each complex transform and tiles run in parallel on
+// the shared thread pool
+template<typename In, typename Out>
+void apply_kernel_fft(MatrixView<const In> input_img,
+                      const Matrix<float>& kernel,
+                      MatrixView<Out> output_img,
+                      BorderMode border_mode = BorderMode::CONSTANT);
+void apply_kernel_fft(MatrixView<const uint32_t> input_img,
+                      const Matrix<float>& kernel,
+                      MatrixView<uint32_t> output_img,
+                      BorderMode border_mode = BorderMode::CONSTANT);
+
+// Spectra of the last kernels are kept (one per kernel and tile size), so that a pipeline applying the same kernel
+// again does not transform it again
+const size_t FFT_KERNEL_CACHE_SIZE = 8;
+void clear_fft_kernel_cache();
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef IMAGE_PROCESSING_GUIDED_FILTER_H
+#define IMAGE_PROCESSING_GUIDED_FILTER_H
+
+#include <cstdint>
+#include <memory>
+
+#include "image_processing/spatial_filtering.h"
+#include "utils/matrix.h"
+
+namespace ip {
+// Edge preserving smoothing of He, Sun and Tang: over every (2 * radius + 1)^2 window the output is fitted as an affine
+// function of the guide, q = a * I + b, and the coefficients of the windows covering a pixel are averaged. Windows
+// where the variance of the guide is well below epsilon are flattened, stronger edges of the guide are kept. epsilon
+// is a variance of intensities scaled to [0, 1] (0.01 keeps edges of about 25 gray levels and more).
+// Every statistic is a box mean, so the cost per pixel does not depend on the radius. The CONSTANT border averages
+// over the pixels inside the image only.
+void guided_filter(std::shared_ptr<Matrix<uint8_t>> input_img,
+                   std::shared_ptr<Matrix<uint8_t>> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   std::shared_ptr<Matrix<uint8_t>> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+void guided_filter(MatrixView<const uint8_t> input_img,
+                   MatrixView<const uint8_t> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   MatrixView<uint8_t> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+
+// Color guide, a is a vector fitted through the 3x3 covariance of the guide channels, so edges are kept when they only
+// show in the color
+void guided_filter(std::shared_ptr<Matrix<uint8_t>> input_img,
+                   std::shared_ptr<Matrix<uint32_t>> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   std::shared_ptr<Matrix<uint8_t>> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+void guided_filter(MatrixView<const uint8_t> input_img,
+                   MatrixView<const uint32_t> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   MatrixView<uint8_t> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+
+// RGB versions, every channel is filtered with the same guide and alpha is set to 255. The input image itself is the
+// usual guide
+void guided_filter(std::shared_ptr<Matrix<uint32_t>> input_img,
+                   std::shared_ptr<Matrix<uint8_t>> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   std::shared_ptr<Matrix<uint32_t>> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+void guided_filter(MatrixView<const uint32_t> input_img,
+                   MatrixView<const uint8_t> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   MatrixView<uint32_t> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+void guided_filter(std::shared_ptr<Matrix<uint32_t>> input_img,
+                   std::shared_ptr<Matrix<uint32_t>> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   std::shared_ptr<Matrix<uint32_t>> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+void guided_filter(MatrixView<const uint32_t> input_img,
+                   MatrixView<const uint32_t> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   MatrixView<uint32_t> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+}
+
+#endif
\ No newline at end of file
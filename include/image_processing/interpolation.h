@@ -6,6 +6,7 @@
 
 #include "image_processing/utils.h"
 #include "utils/matrix.h"
+#include "utils/pixel_traits.h"
 
 namespace ip {
 enum INTERPOLATION_TYPE
@@ -13,20 +14,21 @@ enum INTERPOLATION_TYPE
   BILINEAR
 };
 
-uint8_t interpolate_pixel_bilinear(uint8_t nw_pix,
-                                   uint8_t ne_pix,
-                                   uint8_t sw_pix,
-                                   uint8_t se_pix,
-                                   float row_fraction,
-                                   float col_fraction);
-uint8_t interpolate_pixel(std::shared_ptr<Matrix<uint8_t>> input_img,
-                          float target_row,
-                          float target_col,
-                          INTERPOLATION_TYPE interp_type);
-std::shared_ptr<Matrix<uint8_t>> resize(std::shared_ptr<Matrix<uint8_t>> input_img,
-                                        size_t target_rows,
-                                        size_t target_cols,
-                                        INTERPOLATION_TYPE interp_type = INTERPOLATION_TYPE::BILINEAR);
+// Single channel versions, instantiated for uint8_t, uint16_t and float images
+template<typename T>
+T interpolate_pixel_bilinear(T nw_pix, T ne_pix, T sw_pix, T se_pix, float row_fraction, float col_fraction);
+template<typename T>
+T interpolate_pixel(std::shared_ptr<Matrix<T>> input_img,
+                    float target_row,
+                    float target_col,
+                    INTERPOLATION_TYPE interp_type);
+template<typename T>
+T interpolate_pixel(MatrixView<const T> input_img, float target_row, float target_col, INTERPOLATION_TYPE interp_type);
+template<typename T>
+std::shared_ptr<Matrix<T>> resize(std::shared_ptr<Matrix<T>> input_img,
+                                  size_t target_rows,
+                                  size_t target_cols,
+                                  INTERPOLATION_TYPE interp_type = INTERPOLATION_TYPE::BILINEAR);
 
 RGBAPixel interpolate_pixel_bilinear(RGBAPixel nw_pix,
                                      RGBAPixel ne_pix,
@@ -38,6 +40,10 @@ uint32_t interpolate_pixel(std::shared_ptr<Matrix<uint32_t>> input_img,
                            float target_row,
                            float target_col,
                            INTERPOLATION_TYPE interp_type);
+uint32_t interpolate_pixel(MatrixView<const uint32_t> input_img,
+                           float target_row,
+                           float target_col,
+                           INTERPOLATION_TYPE interp_type);
 std::shared_ptr<Matrix<uint32_t>> resize(std::shared_ptr<Matrix<uint32_t>> input_img,
                                          size_t target_rows,
                                          size_t target_cols,
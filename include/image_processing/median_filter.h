@@ -0,0 +1,48 @@
+#ifndef IMAGE_PROCESSING_MEDIAN_FILTER_H
+#define IMAGE_PROCESSING_MEDIAN_FILTER_H
+
+#include <cstdint>
+#include <memory>
+
+#include "image_processing/spatial_filtering.h"
+#include "utils/matrix.h"
+#include "utils/planar_image.h"
+
+namespace ip {
+// Histogram counts are kept on 16 bits
+const size_t MEDIAN_MAX_KERNEL_SIZE = 255;
+
+// Median over a kernel_size x kernel_size window (the window of box_filter), the lower one for even sizes. Constant
+// time algorithm of Perreault and Hebert: every column keeps the histogram of its kernel_size pixels, slid down one
+// row at a time, and the histogram of the window is slid along the row by adding the entering column and removing
+// the leaving one. Histograms have 16 coarse bins of 16 values, the values of the window are only brought up to date
+// in the coarse bin of the median, so the cost per pixel does not depend on the kernel size.
+// Bands of columns run on the shared thread pool. The CONSTANT border counts the outside pixels as zeros, kernel sizes
+// are capped at MEDIAN_MAX_KERNEL_SIZE
+void median_filter(std::shared_ptr<Matrix<uint8_t>> input_img,
+                   size_t kernel_size,
+                   std::shared_ptr<Matrix<uint8_t>> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+void median_filter(MatrixView<const uint8_t> input_img,
+                   size_t kernel_size,
+                   MatrixView<uint8_t> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+
+// RGB version, every channel is filtered on its own and alpha is set to 255
+void median_filter(std::shared_ptr<Matrix<uint32_t>> input_img,
+                   size_t kernel_size,
+                   std::shared_ptr<Matrix<uint32_t>> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+void median_filter(MatrixView<const uint32_t> input_img,
+                   size_t kernel_size,
+                   MatrixView<uint32_t> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+
+// Planar version, color planes are filtered as gray images and alpha is set to 255
+void median_filter(std::shared_ptr<PlanarImage> input_img,
+                   size_t kernel_size,
+                   std::shared_ptr<PlanarImage> output_img,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+}
+
+#endif
\ No newline at end of file
@@ -5,17 +5,24 @@
 #include <vector>
 
 #include "utils/matrix.h"
+#include "utils/pixel_traits.h"
+#include "utils/planar_image.h"
 
 namespace ip {
 uint8_t normalize_value(uint8_t value, float min, float max);
 
-// GRAY
-std::vector<uint8_t> find_min_max(std::shared_ptr<Matrix<uint8_t>> input_img);
-std::shared_ptr<Matrix<uint8_t>> min_max_normalization(std::shared_ptr<Matrix<uint8_t>> input_img);
+// GRAY, instantiated for uint8_t, uint16_t and float images. Values are stretched to the whole format range
+template<typename T>
+std::vector<T> find_min_max(std::shared_ptr<Matrix<T>> input_img);
+template<typename T>
+std::shared_ptr<Matrix<T>> min_max_normalization(std::shared_ptr<Matrix<T>> input_img);
 
 // RGBA
 std::vector<uint8_t> find_min_max(std::shared_ptr<Matrix<uint32_t>> input_img);
 std::shared_ptr<Matrix<uint32_t>> min_max_normalization(std::shared_ptr<Matrix<uint32_t>> input_img);
+
+// PLANAR, each color channel is normalized independently and alpha is set to 255
+std::shared_ptr<PlanarImage> min_max_normalization(std::shared_ptr<PlanarImage> input_img);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef IMAGE_PROCESSING_RECURSIVE_GAUSSIAN_H
+#define IMAGE_PROCESSING_RECURSIVE_GAUSSIAN_H
+
+#include <cstdint>
+#include <memory>
+
+#include "image_processing/spatial_filtering.h"
+#include "utils/matrix.h"
+#include "utils/planar_image.h"
+
+namespace ip {
+// Recursive gaussian blur (Young and van Vliet, 1995): a causal and an anticausal third order IIR filter along the
+// rows, then along the columns. The cost per pixel does not depend on sigma, which makes large blurs (background
+// estimation...) as cheap as small ones. Lines are padded with 4 sigma of border pixels (following the border mode)
+// for the filters to settle before the image starts.
+// The filter has a unit gain and stays within a few gray levels of an exact gaussian blur on 8 bit images. It gets
+// inaccurate below IIR_GAUSSIAN_MIN_SIGMA, where the kernel based blur (create_gaussian_kernel) should be preferred
+const float IIR_GAUSSIAN_MIN_SIGMA = 2.f;
+
+template<typename T>
+void recursive_gaussian_blur(std::shared_ptr<Matrix<T>> input_img,
+                             float sigma,
+                             std::shared_ptr<Matrix<T>> output_img,
+                             BorderMode border_mode = BorderMode::CONSTANT);
+template<typename T>
+void recursive_gaussian_blur(MatrixView<const T> input_img,
+                             float sigma,
+                             MatrixView<T> output_img,
+                             BorderMode border_mode = BorderMode::CONSTANT);
+
+// RGB version, alpha is set to 255
+void recursive_gaussian_blur(std::shared_ptr<Matrix<uint32_t>> input_img,
+                             float sigma,
+                             std::shared_ptr<Matrix<uint32_t>> output_img,
+                             BorderMode border_mode = BorderMode::CONSTANT);
+void recursive_gaussian_blur(MatrixView<const uint32_t> input_img,
+                             float sigma,
+                             MatrixView<uint32_t> output_img,
+                             BorderMode border_mode = BorderMode::CONSTANT);
+
+// Planar version, color planes are blurred as gray images and alpha is set to 255
+void recursive_gaussian_blur(std::shared_ptr<PlanarImage> input_img,
+                             float sigma,
+                             std::shared_ptr<PlanarImage> output_img,
+                             BorderMode border_mode = BorderMode::CONSTANT);
+}
+
+#endif
\ No newline at end of file
@@ -1,40 +1,276 @@
 #ifndef IMAGE_PROCESSING_SPATIAL_FILTERING_H
 #define IMAGE_PROCESSING_SPATIAL_FILTERING_H
 
+#include <cmath>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
+#include "utils/math.h"
 #include "utils/matrix.h"
+#include "utils/pixel_traits.h"
+#include "utils/planar_image.h"
 
 namespace ip {
-// Grayscale version
-void apply_kernel(std::shared_ptr<Matrix<uint8_t>> input_img,
+// Every filter exists in two flavors: shared_ptr based ones, that (re)allocate the output if needed, and view
+// based ones, working on a region of interest. For views, input and output must have the same size and the input
+// view is considered as the whole image (taps outside of it follow the border mode).
+// The 2D kernel overloads pick their algorithm: two 1D passes for rank-1 kernels, FFTs for large kernels (see
+// image_processing/fft_convolution.h) and the direct correlation otherwise. All of them split the output rows in
+// bands run on the shared thread pool, the result is the same whatever the number of threads.
+
+// Value read by the taps falling outside of the image
+enum class BorderMode
+{
+  CONSTANT,  // zero, the historical behavior (taps are dropped)
+  REPLICATE, // edge pixel repeated: aaa|abcd|ddd
+  REFLECT,   // mirror around the edge pixel, which is not repeated: cb|abcd|cb
+  WRAP       // periodic image: bcd|abcd|abc
+};
+
+// Source index of a coordinate along an axis of the given size, -1 for the CONSTANT border
+int border_index(int index, int size, BorderMode border_mode);
+
+// Single channel version, instantiated for every format of utils/pixel_traits.h. The absolute response is
+// saturated to the output format range (float outputs keep the raw absolute response). Inputs can also be filtered
+// into a float output, with the same input format
+template<typename In, typename Out>
+void apply_kernel(std::shared_ptr<Matrix<In>> input_img,
                   std::shared_ptr<Matrix<float>> kernel,
-                  std::shared_ptr<Matrix<uint8_t>> output_img);
-uint8_t apply_kernel_on_pixel(std::shared_ptr<Matrix<uint8_t>> input_img,
-                              std::shared_ptr<Matrix<float>> kernel,
-                              size_t row,
-                              size_t col);
+                  std::shared_ptr<Matrix<Out>> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
+template<typename T>
+T apply_kernel_on_pixel(std::shared_ptr<Matrix<T>> input_img,
+                        std::shared_ptr<Matrix<float>> kernel,
+                        size_t row,
+                        size_t col,
+                        BorderMode border_mode = BorderMode::CONSTANT);
+template<typename In, typename Out>
+void apply_kernel(MatrixView<const In> input_img,
+                  const Matrix<float>& kernel,
+                  MatrixView<Out> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
+template<typename T>
+T apply_kernel_on_pixel(MatrixView<const T> input_img,
+                        const Matrix<float>& kernel,
+                        size_t row,
+                        size_t col,
+                        BorderMode border_mode = BorderMode::CONSTANT);
 
 // RGB version
 void apply_kernel(std::shared_ptr<Matrix<uint32_t>> input_img,
                   std::shared_ptr<Matrix<float>> kernel,
-                  std::shared_ptr<Matrix<uint32_t>> output_img);
+                  std::shared_ptr<Matrix<uint32_t>> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
 uint32_t apply_kernel_on_pixel(std::shared_ptr<Matrix<uint32_t>> input_img,
                                std::shared_ptr<Matrix<float>> kernel,
                                size_t row,
-                               size_t col);
+                               size_t col,
+                               BorderMode border_mode = BorderMode::CONSTANT);
+void apply_kernel(MatrixView<const uint32_t> input_img,
+                  const Matrix<float>& kernel,
+                  MatrixView<uint32_t> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
+uint32_t apply_kernel_on_pixel(MatrixView<const uint32_t> input_img,
+                               const Matrix<float>& kernel,
+                               size_t row,
+                               size_t col,
+                               BorderMode border_mode = BorderMode::CONSTANT);
 
-// Float version
-void apply_kernel(std::shared_ptr<Matrix<uint8_t>> input_img,
+// Planar version, color channels are filtered as gray planes and alpha is set to 255 (as for packed RGBA)
+void apply_kernel(std::shared_ptr<PlanarImage> input_img,
                   std::shared_ptr<Matrix<float>> kernel,
-                  std::shared_ptr<Matrix<float>> output_img);
-float apply_kernel_on_pixel_float(std::shared_ptr<Matrix<uint8_t>> input_img,
+                  std::shared_ptr<PlanarImage> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
+
+// Separable kernels, the 2D kernel is the outer product kernel(x, y) == vertical[x] * horizontal[y]. They run as two
+// 1D passes (2K taps per pixel instead of K^2) and give the same results as the 2D kernel, up to float rounding.
+// The 2D apply_kernel overloads detect rank-1 kernels (gaussian, sobel, box...) and take this path on their own
+struct SeparableKernel
+{
+  std::vector<float> vertical;
+  std::vector<float> horizontal;
+};
+
+// Relative tolerance, to the largest coefficient, of the rank-1 check
+const float SEPARABLE_KERNEL_TOLERANCE = 1e-5f;
+
+// Returns false when the kernel is not separable
+bool decompose_separable_kernel(const Matrix<float>& kernel, SeparableKernel& separable_kernel);
+template<typename In, typename Out>
+void apply_kernel(MatrixView<const In> input_img,
+                  const SeparableKernel& kernel,
+                  MatrixView<Out> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
+void apply_kernel(MatrixView<const uint32_t> input_img,
+                  const SeparableKernel& kernel,
+                  MatrixView<uint32_t> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
+
+// Float response of a single pixel
+template<typename T>
+float apply_kernel_on_pixel_float(std::shared_ptr<Matrix<T>> input_img,
                                   std::shared_ptr<Matrix<float>> kernel,
                                   size_t row,
-                                  size_t col);
+                                  size_t col,
+                                  BorderMode border_mode = BorderMode::CONSTANT);
+template<typename T>
+float apply_kernel_on_pixel_float(MatrixView<const T> input_img,
+                                  const Matrix<float>& kernel,
+                                  size_t row,
+                                  size_t col,
+                                  BorderMode border_mode = BorderMode::CONSTANT);
+
+// Filter banks: several kernels of the same size applied in a single traversal of the input. Each input neighborhood
+// is read once (and stays in cache) for all the kernels instead of once per kernel. Every output is the response of
+// the direct correlation of apply_kernel, kernels are never decomposed nor sent to FFTs, so banks are meant for small
+// kernels (derivatives, oriented edges...)
+template<typename In, typename Out>
+void apply_kernels(std::shared_ptr<Matrix<In>> input_img,
+                   const std::vector<std::shared_ptr<Matrix<float>>>& kernels,
+                   const std::vector<std::shared_ptr<Matrix<Out>>>& output_imgs,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+template<typename In, typename Out>
+void apply_kernels(MatrixView<const In> input_img,
+                   const std::vector<Matrix<float>>& kernels,
+                   const std::vector<MatrixView<Out>>& output_imgs,
+                   BorderMode border_mode = BorderMode::CONSTANT);
+
+// Single output bank, the magnitude sqrt(sum of the squared responses) saturated to the output format
+template<typename In, typename Out>
+void apply_kernels_magnitude(std::shared_ptr<Matrix<In>> input_img,
+                             const std::vector<std::shared_ptr<Matrix<float>>>& kernels,
+                             std::shared_ptr<Matrix<Out>> output_img,
+                             BorderMode border_mode = BorderMode::CONSTANT);
+template<typename In, typename Out>
+void apply_kernels_magnitude(MatrixView<const In> input_img,
+                             const std::vector<Matrix<float>>& kernels,
+                             MatrixView<Out> output_img,
+                             BorderMode border_mode = BorderMode::CONSTANT);
+
+// Kernels whose size is known at compile time. Their taps are fully unrolled and summed in registers (no loop over
+// the kernel at runtime), which pays off for the small kernels of the edge detectors. Rank-1 kernels from 5x5 up
+// still take the separable path, as the generic overloads do.
+// Instantiated for 3x3 and 5x5 kernels, on the same formats as the generic overloads
+template<size_t N, size_t M>
+struct FixedKernel
+{
+  float coefficients[N][M];
+
+  constexpr float operator()(size_t row, size_t col) const { return coefficients[row][col]; };
+
+  // Runtime copy, for the generic overloads
+  std::shared_ptr<Matrix<float>> to_matrix() const
+  {
+    auto kernel = std::make_shared<Matrix<float>>(N, M);
+    for (size_t row = 0; row < N; ++row) {
+      for (size_t col = 0; col < M; ++col) {
+        kernel->operator()(row, col) = coefficients[row][col];
+      }
+    }
+    return kernel;
+  };
+};
+
+template<size_t N, size_t M, typename In, typename Out>
+void apply_kernel(std::shared_ptr<Matrix<In>> input_img,
+                  const FixedKernel<N, M>& kernel,
+                  std::shared_ptr<Matrix<Out>> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
+template<size_t N, size_t M, typename In, typename Out>
+void apply_kernel(MatrixView<const In> input_img,
+                  const FixedKernel<N, M>& kernel,
+                  MatrixView<Out> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
+template<size_t N, size_t M>
+void apply_kernel(std::shared_ptr<Matrix<uint32_t>> input_img,
+                  const FixedKernel<N, M>& kernel,
+                  std::shared_ptr<Matrix<uint32_t>> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
+template<size_t N, size_t M>
+void apply_kernel(MatrixView<const uint32_t> input_img,
+                  const FixedKernel<N, M>& kernel,
+                  MatrixView<uint32_t> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
+template<size_t N, size_t M>
+void apply_kernel(std::shared_ptr<PlanarImage> input_img,
+                  const FixedKernel<N, M>& kernel,
+                  std::shared_ptr<PlanarImage> output_img,
+                  BorderMode border_mode = BorderMode::CONSTANT);
+
+// Same coefficients as create_gaussian_kernel, computed at compile time
+template<size_t N>
+constexpr FixedKernel<N, N> make_gaussian_kernel(float sigma)
+{
+  FixedKernel<N, N> kernel{};
+  int kernel_semi_size = (int(N) - 1) / 2;
+  float sum = 0.f;
+  for (size_t row = 0; row < N; ++row) {
+    for (size_t col = 0; col < N; ++col) {
+      float row_value = (float(row) - kernel_semi_size) * (float(row) - kernel_semi_size);
+      float col_value = (float(col) - kernel_semi_size) * (float(col) - kernel_semi_size);
+      kernel.coefficients[row][col] = float(constexpr_exp(-(row_value + col_value) / (2.f * sigma * sigma)));
+      sum += kernel.coefficients[row][col];
+    }
+  }
+  for (size_t row = 0; row < N; ++row) {
+    for (size_t col = 0; col < N; ++col) {
+      kernel.coefficients[row][col] /= sum;
+    }
+  }
+  return kernel;
+}
 
 // Classic kernels
+constexpr FixedKernel<3, 3> SOBEL_H_KERNEL{ { { -1.f, -2.f, -1.f }, { 0.f, 0.f, 0.f }, { 1.f, 2.f, 1.f } } };
+constexpr FixedKernel<3, 3> SOBEL_V_KERNEL{ { { -1.f, 0.f, 1.f }, { -2.f, 0.f, 2.f }, { -1.f, 0.f, 1.f } } };
+// Blur of the canny edge detector
+constexpr FixedKernel<5, 5> GAUSSIAN_5X5_KERNEL = make_gaussian_kernel<5>(1.f);
+// Center pixel minus the mean of its neighborhood
+constexpr FixedKernel<3, 3> EDGE_3X3_KERNEL{
+  { { -0.125f, -0.125f, -0.125f }, { -0.125f, 1.f, -0.125f }, { -0.125f, -0.125f, -0.125f } }
+};
+// Same with the closest neighbors weighted twice
+constexpr FixedKernel<5, 5> EDGE_5X5_KERNEL{ { { -1 / 32.f, -1 / 32.f, -1 / 32.f, -1 / 32.f, -1 / 32.f },
+                                               { -1 / 32.f, -2 / 32.f, -2 / 32.f, -2 / 32.f, -1 / 32.f },
+                                               { -1 / 32.f, -2 / 32.f, 1.f, -2 / 32.f, -1 / 32.f },
+                                               { -1 / 32.f, -2 / 32.f, -2 / 32.f, -2 / 32.f, -1 / 32.f },
+                                               { -1 / 32.f, -1 / 32.f, -1 / 32.f, -1 / 32.f, -1 / 32.f } } };
+
+// Fixed point path of the 8 bits images: kernel(x, y) ~ weights[x * cols + y] / 2^shift, with 16 bits weights and
+// 32 bits integer sums, which vectorizes twice as wide as the float path (see spatial_filtering_simd.h)
+struct FixedPointKernel
+{
+  size_t rows = 0, cols = 0;
+  std::vector<int16_t> weights;
+  int shift = 0;
+};
+
+// Quantizes with the largest shift that keeps the weights on 16 bits. Returns false when the rounding of the weights
+// could move a response by half a gray level or more, or when the 32 bits sums could overflow
+bool quantize_kernel(const Matrix<float>& kernel, FixedPointKernel& fixed_point_kernel);
+
+// Responses stay within 1 gray level of apply_kernel. Kernels that cannot be quantized, large kernels (FFT) and
+// separable kernels whose two 1D passes are cheaper go through apply_kernel
+void apply_kernel_fixed_point(std::shared_ptr<Matrix<uint8_t>> input_img,
+                              std::shared_ptr<Matrix<float>> kernel,
+                              std::shared_ptr<Matrix<uint8_t>> output_img,
+                              BorderMode border_mode = BorderMode::CONSTANT);
+void apply_kernel_fixed_point(MatrixView<const uint8_t> input_img,
+                              const Matrix<float>& kernel,
+                              MatrixView<uint8_t> output_img,
+                              BorderMode border_mode = BorderMode::CONSTANT);
+
+// RGB version, alpha is set to 255
+void apply_kernel_fixed_point(std::shared_ptr<Matrix<uint32_t>> input_img,
+                              std::shared_ptr<Matrix<float>> kernel,
+                              std::shared_ptr<Matrix<uint32_t>> output_img,
+                              BorderMode border_mode = BorderMode::CONSTANT);
+void apply_kernel_fixed_point(MatrixView<const uint32_t> input_img,
+                              const Matrix<float>& kernel,
+                              MatrixView<uint32_t> output_img,
+                              BorderMode border_mode = BorderMode::CONSTANT);
+
 std::shared_ptr<Matrix<float>> create_gaussian_kernel(int kernel_size, float sigma);
 std::shared_ptr<Matrix<float>> create_sobel_h_kernel();
 std::shared_ptr<Matrix<float>> create_sobel_v_kernel();
@@ -0,0 +1,54 @@
+#ifndef IMAGE_PROCESSING_SPATIAL_FILTERING_SIMD_H
+#define IMAGE_PROCESSING_SPATIAL_FILTERING_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Row primitives of the correlations. Kernels are applied tap after tap along whole rows, which vectorizes across
+// the output pixels whatever the kernel size. Every primitive has a scalar version (the reference) and SSE4.1, AVX2
+// and AVX-512 versions, the widest one supported by the host is picked at runtime (see utils/cpu_features.h).
+// All of them compute exactly the same operations in the same order (no FMA), so the results are bit-identical
+// whatever the instruction set.
+namespace ip {
+namespace simd {
+// acc[i] += input[i] * weight, for uint8_t, uint16_t and float inputs
+template<typename T>
+void accumulate_row(const T* input, float weight, float* acc, size_t size);
+
+// Same on the R, G and B channels of packed RGBA pixels
+void accumulate_rgba_row(const uint32_t* input, float weight, float* r_acc, float* g_acc, float* b_acc, size_t size);
+
+// output[i] = PixelTraits<T>::saturate(|acc[i]|), for uint8_t, uint16_t and float outputs
+template<typename T>
+void store_row(const float* acc, T* output, size_t size);
+
+// Packed RGBA version, alpha is set to 255
+void store_rgba_row(const float* r_acc, const float* g_acc, const float* b_acc, uint32_t* output, size_t size);
+
+// Whole correlation of a row with a N x M kernel known at compile time (instantiated for 3x3 and 5x5):
+// acc[i] = sum of input_rows[x][i + y] * kernel[x][y]. The taps are unrolled and the sums stay in registers, the
+// taps are added in the same order as accumulate_row called tap after tap
+template<size_t N, size_t M, typename T>
+void correlate_row(const T* const* input_rows, const float (&kernel)[N][M], float* acc, size_t size);
+template<size_t N, size_t M>
+void correlate_rgba_row(const uint32_t* const* input_rows,
+                        const float (&kernel)[N][M],
+                        float* r_acc,
+                        float* g_acc,
+                        float* b_acc,
+                        size_t size);
+
+// Fixed point correlation of a row of 8 bits pixels, with 16 bits weights and 32 bits integer sums:
+// output[i] = min(|sum of inputs[tap][i] * weights[tap]| >> shift, 255), for an even number of taps. Taps go by
+// pairs, one 16 bits multiply-add per pixel, and twice as many pixels fit in a register as with floats. The sums stay
+// in registers and integer sums make every version exact
+void correlate_fixed_point_row(const uint8_t* const* inputs,
+                               const int16_t* weights,
+                               size_t taps,
+                               int shift,
+                               uint8_t* output,
+                               size_t size);
+}
+}
+
+#endif
\ No newline at end of file
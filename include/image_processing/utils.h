@@ -6,6 +6,8 @@
 #include <memory>
 
 #include <utils/matrix.h>
+#include <utils/pixel_traits.h>
+#include <utils/planar_image.h>
 
 class RGBAPixel
 {
@@ -37,18 +39,44 @@ public:
 };
 
 namespace ip {
-std::shared_ptr<Matrix<uint8_t>> rgba_to_gray(std::shared_ptr<Matrix<uint32_t>> rgba_img);
-std::shared_ptr<Matrix<uint32_t>> gray_to_rgba(std::shared_ptr<Matrix<uint8_t>> gray_img);
+// Gray <=> RGBA for the single channel formats (uint8_t, uint16_t, float), the 8 bit range of the color channels is
+// mapped on the range of the gray format
+template<typename T = uint8_t>
+std::shared_ptr<Matrix<T>> rgba_to_gray(std::shared_ptr<Matrix<uint32_t>> rgba_img);
+template<typename T>
+std::shared_ptr<Matrix<uint32_t>> gray_to_rgba(std::shared_ptr<Matrix<T>> gray_img);
+template<typename T>
+void rgba_to_gray(MatrixView<const uint32_t> rgba_img, MatrixView<T> gray_img);
+template<typename T>
+void gray_to_rgba(MatrixView<const T> gray_img, MatrixView<uint32_t> rgba_img);
+
+// Single channel format conversions (uint8_t, uint16_t, float), the range of a format is mapped on the other one
+template<typename To, typename From>
+std::shared_ptr<Matrix<To>> convert_pixel_format(std::shared_ptr<Matrix<From>> input_img);
+
+// Packed <=> planar, channel order is kept so these work for both RGBA and HSVA images
+std::shared_ptr<PlanarImage> rgba_to_planar(std::shared_ptr<Matrix<uint32_t>> rgba_img);
+std::shared_ptr<Matrix<uint32_t>> planar_to_rgba(std::shared_ptr<PlanarImage> planar_img);
+template<typename T = uint8_t>
+std::shared_ptr<Matrix<T>> planar_to_gray(std::shared_ptr<PlanarImage> planar_img);
 
 // RGBA <=> HSVA
 std::shared_ptr<Matrix<uint32_t>> rgba_to_hsva(std::shared_ptr<Matrix<uint32_t>> rgba_img);
 std::shared_ptr<Matrix<uint32_t>> hsva_to_rgba(std::shared_ptr<Matrix<uint32_t>> hsva_img);
+// The output may be the input itself, for in place conversions
+void rgba_to_hsva(MatrixView<const uint32_t> rgba_img, MatrixView<uint32_t> hsva_img);
+void hsva_to_rgba(MatrixView<const uint32_t> hsva_img, MatrixView<uint32_t> rgba_img);
 
 // HSV
 std::shared_ptr<Matrix<uint32_t>> hsva_transformation(std::shared_ptr<Matrix<uint32_t>> hsva_img,
                                                       double hue_rotation,
                                                       double saturation_factor,
                                                       double value_factor);
+void hsva_transformation(MatrixView<const uint32_t> hsva_img,
+                         MatrixView<uint32_t> out_img,
+                         double hue_rotation,
+                         double saturation_factor,
+                         double value_factor);
 }
 
 #endif
\ No newline at end of file
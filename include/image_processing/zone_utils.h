@@ -8,11 +8,25 @@
 #include "utils/matrix.h"
 
 namespace ip {
+// Bounding box of one zone, as views over the source images (no pixel is copied). Pixels of the box that do not
+// belong to the zone are the ones where zone_view(row, col) != zone_value.
+struct ZoneROI
+{
+  uint8_t zone_value;
+  MatrixView<const uint32_t> rgba_view;
+  MatrixView<const uint8_t> zone_view;
+};
+
 std::shared_ptr<Matrix<uint8_t>> get_borders(std::shared_ptr<Matrix<uint8_t>> img,
                                              uint8_t threshold = 0,
                                              int neighborhood_size = 2);
 bool is_border(std::shared_ptr<Matrix<uint8_t>> img, int row, int col, uint8_t threshold, int neighborhood_size = 2);
+bool is_border(MatrixView<const uint8_t> img, int row, int col, uint8_t threshold, int neighborhood_size = 2);
 
+// Views are only valid as long as rgba_img and zone_img are alive
+std::vector<ZoneROI> extract_zone_rois(std::shared_ptr<Matrix<uint32_t>> rgba_img,
+                                       std::shared_ptr<Matrix<uint8_t>> zone_img,
+                                       int number_of_clusters);
 std::vector<std::shared_ptr<Matrix<uint32_t>>> extract_zone_images(std::shared_ptr<Matrix<uint32_t>> rgba_img,
                                                                    std::shared_ptr<Matrix<uint8_t>> zone_img,
                                                                    int number_of_clusters);
@@ -8,15 +8,42 @@
 #include <vector>
 
 #include "utils/matrix.h"
+#include "utils/planar_image.h"
 
 enum ImageType
 {
   UNKNOWN,
   GRAY,
   RGBA,
-  FULL
+  FULL,
+  PLANAR,
+  GRAY16
 };
 
+// Copy-on-write of the image buffers. The images returned by Context::get_image share their buffers with the context
+// (and with every other image derived from them without modification), so they are read-only: a processor that wants
+// to work in place goes through one of these helpers, which only copy or allocate when the buffer is actually shared.
+// A private copy of the buffer, or the buffer itself when nobody else holds it
+template<typename T>
+std::shared_ptr<T> make_writable(std::shared_ptr<T>& buffer)
+{
+  if (buffer && buffer.use_count() > 1) {
+    buffer = std::make_shared<T>(*buffer);
+  }
+  return buffer;
+}
+
+// Output buffer for a result that overwrites every element of its input: the input buffer itself when nobody else
+// holds it, a new uninitialized one of the same size otherwise (nothing is copied)
+template<typename T>
+std::shared_ptr<T> make_output(const std::shared_ptr<T>& input)
+{
+  if (input.use_count() > 1) {
+    return std::make_shared<T>(input->get_rows(), input->get_cols());
+  }
+  return input;
+}
+
 struct Image
 {
   ImageType type = ImageType::UNKNOWN;
@@ -24,6 +51,10 @@ struct Image
   // Placeholder for RGBA and Gray images
   std::shared_ptr<Matrix<uint32_t>> rgba_img = nullptr;
   std::shared_ptr<Matrix<uint8_t>> gray_img = nullptr;
+  // Planar images are stored alone, never alongside a packed one
+  std::shared_ptr<PlanarImage> planar_img = nullptr;
+  // 16 bits grayscale images are stored alone as well, they are converted to 8 bits for display and saving
+  std::shared_ptr<Matrix<uint16_t>> gray16_img = nullptr;
 
   Image(){};
   Image(std::shared_ptr<Matrix<uint8_t>> _gray_img)
@@ -36,6 +67,16 @@ struct Image
     rgba_img = _rgba_img;
     type = ImageType::RGBA;
   };
+  Image(std::shared_ptr<PlanarImage> _planar_img)
+  {
+    planar_img = _planar_img;
+    type = ImageType::PLANAR;
+  };
+  Image(std::shared_ptr<Matrix<uint16_t>> _gray16_img)
+  {
+    gray16_img = _gray16_img;
+    type = ImageType::GRAY16;
+  };
 };
 
 class Context
@@ -44,12 +85,21 @@ public:
   Context();
   ~Context() = default;
 
+  // Images are stored by reference, adding an image never copies its buffers
   void add_image(std::string img_name, Image img);
+  // The returned buffers are shared with the context, see make_writable / make_output before modifying them
   Image get_image(std::string img_name);
+  // Deleting the output of a processor before computing it lets the processor reuse the input buffer when it
+  // overwrites its own input
   void delete_image(std::string img_name);
   void save_image(std::string img_name, std::string filepath);
 
   static void save_rgba_image_png(std::shared_ptr<Matrix<uint32_t>> rgba_img, std::string filepath);
+  // Save a region of interest. When a mask is given, pixels where mask != mask_value are written black
+  static void save_rgba_image_png(MatrixView<const uint32_t> rgba_img,
+                                  std::string filepath,
+                                  MatrixView<const uint8_t> mask = MatrixView<const uint8_t>(),
+                                  uint8_t mask_value = 0);
   static void save_gray_image_png(std::shared_ptr<Matrix<uint8_t>> gray_img, std::string filepath);
   static void save_rgba_image(std::shared_ptr<Matrix<uint32_t>> rgba_img, std::string filepath);
   static void save_gray_image(std::shared_ptr<Matrix<uint8_t>> gray_img, std::string filepath);
@@ -57,6 +107,8 @@ public:
 private:
   std::map<std::string, std::shared_ptr<Matrix<uint32_t>>> imgs;
   std::map<std::string, std::shared_ptr<Matrix<uint8_t>>> gray_imgs;
+  std::map<std::string, std::shared_ptr<PlanarImage>> planar_imgs;
+  std::map<std::string, std::shared_ptr<Matrix<uint16_t>>> gray16_imgs;
 
   void add_rgba_image(std::string img_name, std::shared_ptr<Matrix<uint32_t>> img);
   std::shared_ptr<Matrix<uint32_t>> get_rgba_image(std::string img_name);
@@ -64,6 +116,12 @@ private:
   void add_gray_image(std::string img_name, std::shared_ptr<Matrix<uint8_t>> img);
   std::shared_ptr<Matrix<uint8_t>> get_gray_image(std::string img_name, bool convert_color_img = true);
 
+  void add_planar_image(std::string img_name, std::shared_ptr<PlanarImage> img);
+  std::shared_ptr<PlanarImage> get_planar_image(std::string img_name);
+
+  void add_gray16_image(std::string img_name, std::shared_ptr<Matrix<uint16_t>> img);
+  std::shared_ptr<Matrix<uint16_t>> get_gray16_image(std::string img_name);
+
   void save_rgba_image(std::string img_name);
   void save_gray_image(std::string img_name);
 };
@@ -13,6 +13,11 @@ const std::string COLOR_RGB2HSV = "RGB to HSV";
 const std::string COLOR_HSV2RGB = "HSV to RGB";
 const std::string COLOR_RGB2GRAY = "RGB to Gray";
 const std::string COLOR_GRAY2RGB = "Gray to RGB";
+const std::string COLOR_RGB2PLANAR = "RGB to planar";
+const std::string COLOR_PLANAR2RGB = "Planar to RGB";
+const std::string COLOR_GRAY2GRAY16 = "Gray to Gray16";
+const std::string COLOR_GRAY162GRAY = "Gray16 to Gray";
+const std::string COLOR_RGB2GRAY16 = "RGB to Gray16";
 
 class ColorConversionProcessor : public BaseProcessor
 {
@@ -13,6 +13,12 @@
 
 const std::string KERNEL_SIZE = "Kernel size";
 const std::string KERNEL_STD = "Kernel standard deviation";
+const std::string SF_BORDER_MODE = "Border mode";
+const std::string SF_BORDER_CONSTANT = "Constant";
+const std::string SF_BORDER_REPLICATE = "Replicate";
+const std::string SF_BORDER_REFLECT = "Reflect";
+const std::string SF_BORDER_WRAP = "Wrap";
+const std::string SF_FIXED_POINT = "Fixed point (8 bits)";
 
 class SpatialFilteringProcessor : public BaseProcessor
 {
@@ -29,16 +35,61 @@ private:
   };
 };
 
+const std::string GB_METHOD = "Method";
+const std::string GB_METHOD_KERNEL = "Kernel";
+const std::string GB_METHOD_RECURSIVE = "Recursive (IIR)";
+
 class GaussianBlurProcessor : public SpatialFilteringProcessor
 {
 public:
   GaussianBlurProcessor();
   ~GaussianBlurProcessor() = default;
 
+  bool process(Context& context, std::string img_name, std::string output_img_name) override;
+
 private:
   std::shared_ptr<Matrix<float>> create_kernel(Configuration& config) override;
 };
 
+const std::string BOX_STATISTIC = "Statistic";
+const std::string BOX_STATISTIC_MEAN = "Mean";
+const std::string BOX_STATISTIC_VARIANCE = "Variance";
+
+// Mean or variance over a square window, with a cost per pixel that does not depend on the kernel size
+class BoxFilterProcessor : public SpatialFilteringProcessor
+{
+public:
+  BoxFilterProcessor();
+  ~BoxFilterProcessor() = default;
+
+  bool process(Context& context, std::string img_name, std::string output_img_name) override;
+};
+
+// Median over a square window, the 8 bits images are filtered in a time that does not depend on the kernel size
+class MedianFilterProcessor : public SpatialFilteringProcessor
+{
+public:
+  MedianFilterProcessor();
+  ~MedianFilterProcessor() = default;
+
+  bool process(Context& context, std::string img_name, std::string output_img_name) override;
+};
+
+const std::string GF_RADIUS = "Radius";
+const std::string GF_EPSILON = "Epsilon";
+const std::string GF_GUIDE = "Guide image";
+
+// Edge preserving smoothing with a cost per pixel that does not depend on the radius. The image is its own guide
+// unless the name of another gray or RGBA image of the same size is given
+class GuidedFilterProcessor : public SpatialFilteringProcessor
+{
+public:
+  GuidedFilterProcessor();
+  ~GuidedFilterProcessor() = default;
+
+  bool process(Context& context, std::string img_name, std::string output_img_name) override;
+};
+
 const std::string EDGE_ALGORITHM = "Algorithm";
 const std::string EDGE_KERNEL_ALGORITHM = "Kernel";
 const std::string EDGE_MORPH_H_ALGORITHM = "Horizontal morphological gradient";
@@ -0,0 +1,22 @@
+#ifndef UTILS_CPU_FEATURES_H
+#define UTILS_CPU_FEATURES_H
+
+namespace utils {
+// Instruction sets the SIMD kernels are compiled for, from the narrowest to the widest. The same binary runs on every
+// x86-64 host, each kernel picks the widest level supported by the CPU (and enabled by the OS) at runtime
+enum class SimdLevel
+{
+  SCALAR,
+  SSE41,
+  AVX2,
+  AVX512 // F and BW
+};
+
+// Detected once through CPUID. The CVUI_SIMD environment variable (scalar, sse4.1, avx2 or avx512) lowers the level,
+// to compare the paths or to work around a faulty one. It never raises it above what the CPU supports
+SimdLevel get_simd_level();
+
+const char* get_simd_level_name(SimdLevel level);
+}
+
+#endif
\ No newline at end of file
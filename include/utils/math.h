@@ -1,6 +1,27 @@
 #ifndef UTILS_MATH_H
 #define UTILS_MATH_H
 
+// Compile-time exponential (std::exp is not constexpr), accurate to the double precision. Halves the argument until
+// it is small, sums the Taylor series and squares the result back
+constexpr double constexpr_exp(double value)
+{
+  int n_halvings = 0;
+  while (value > 0.5 || value < -0.5) {
+    value /= 2.;
+    ++n_halvings;
+  }
+  double result = 1.;
+  double term = 1.;
+  for (int i = 1; i < 20; ++i) {
+    term *= value / i;
+    result += term;
+  }
+  for (int i = 0; i < n_halvings; ++i) {
+    result *= result;
+  }
+  return result;
+}
+
 struct Point
 {
   float x, y;
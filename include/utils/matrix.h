@@ -5,6 +5,22 @@
 #ifndef CAMERAAPP_MATRIX_H
 #define CAMERAAPP_MATRIX_H
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+#include "utils/matrix_expression.h"
+#include "utils/matrix_view.h"
+#include "utils/memory.h"
+
+enum class MatrixLayout
+{
+  DENSE,       // rows are packed one after the other (stride == cols)
+  ALIGNED_ROWS // rows are padded so that each of them starts on a MEMORY_ALIGNMENT boundary
+};
+
 template<typename T>
 class Matrix
 {
@@ -12,31 +28,52 @@ private:
   T* mat;
   size_t rows;
   size_t cols;
+  // Distance, in elements, between the start of two consecutive rows
+  size_t stride;
+
+  // Release function of the buffer, either the aligned allocator one or a custom one for adopted buffers
+  std::function<void(T*)> deleter;
+
+  void allocate(size_t _rows, size_t _cols, size_t _stride);
+  void copy_from(const T* buffer, size_t buffer_stride);
+  void release();
 
 public:
   Matrix();
-  Matrix(size_t _rows, size_t _cols);
+  // The elements are left uninitialized (buffers may be recycled from the pool), use fill() when needed
+  Matrix(size_t _rows, size_t _cols, MatrixLayout layout = MatrixLayout::DENSE);
   Matrix(size_t _rows, size_t _cols, T* buffer);
+  // Adopt an existing buffer without copying it. The deleter is called once the matrix is destroyed, a no-op
+  // deleter can be used to simply wrap a buffer owned elsewhere (it then has to outlive the matrix).
+  // A stride of 0 means the buffer rows are packed (stride == cols)
+  Matrix(size_t _rows, size_t _cols, T* buffer, std::function<void(T*)> _deleter, size_t _stride = 0);
   Matrix(const Matrix<T>& rhs);
+  Matrix(Matrix<T>&& rhs) noexcept;
+  // Materialize a (dense) copy of a view
+  template<typename U, typename = std::enable_if_t<std::is_same<std::remove_const_t<U>, T>::value>>
+  explicit Matrix(const MatrixView<U>& view);
+  // Evaluate an elementwise expression (see utils/matrix_expression.h) in a single pass
+  template<typename E>
+  Matrix(const MatrixExpression<E>& expression, ExecutionMode mode = ExecutionMode::SEQUENTIAL);
   ~Matrix();
 
   // Operator overloading, for "standard" mathematical matrix operations
   Matrix<T>& operator=(const Matrix<T>& rhs);
+  Matrix<T>& operator=(Matrix<T>&& rhs) noexcept;
+  // The buffer is reused when the sizes match, the expression may read this matrix
+  template<typename E>
+  Matrix<T>& operator=(const MatrixExpression<E>& expression);
 
-  // Matrix mathematical operations
-  Matrix<T>& operator+(const Matrix<T>& rhs);
+  // Elementwise operations, in place. Binary +, -, *, / (with matrices, views or scalars) are expression
+  // templates defined in utils/matrix_expression.h
   Matrix<T>& operator+=(const Matrix<T>& rhs);
-  Matrix<T>& operator-(const Matrix<T>& rhs);
   Matrix<T>& operator-=(const Matrix<T>& rhs);
-  Matrix<T>& operator*(const Matrix<T>& rhs);
   Matrix<T>& operator*=(const Matrix<T>& rhs);
-  Matrix<T> transpose();
 
-  // Matrix/scalar operations
-  Matrix<T> operator+(const T& rhs);
-  Matrix<T> operator-(const T& rhs);
-  Matrix<T> operator*(const T& rhs);
-  Matrix<T> operator/(const T& rhs);
+  // Cache-blocked transpose. Column passes can be written as row passes over the transposed matrix
+  Matrix<T> transpose() const;
+  // Square matrices are transposed without any allocation, other shapes go through a temporary
+  void transpose_in_place();
 
   // Access the individual elements
   T& operator()(const size_t& row, const size_t& col);
@@ -52,9 +89,45 @@ public:
     return true;
   };
 
+  // Set every element to the same value
+  void fill(const T& value);
+
   // Access the row and column sizes
   size_t get_rows() const;
   size_t get_cols() const;
+
+  // Memory layout. Element (row, col) lives at data()[row * get_stride() + col]
+  size_t get_stride() const { return stride; };
+  bool is_contiguous() const { return stride == cols; };
+
+  // Access the raw buffer
+  T* data() { return mat; };
+  const T* data() const { return mat; };
+
+  // Access a whole row, valid for indexes [0, get_cols())
+  T* row_ptr(const size_t& row) { return mat + row * stride; };
+  const T* row_ptr(const size_t& row) const { return mat + row * stride; };
+  RowSpan<T> row(const size_t& row) { return RowSpan<T>(mat + row * stride, cols); };
+  RowSpan<const T> row(const size_t& row) const { return RowSpan<const T>(mat + row * stride, cols); };
+
+  // Range-for support, iterates over the rows (see MatrixView)
+  RowIterator<T> begin() { return view().begin(); };
+  RowIterator<T> end() { return view().end(); };
+  RowIterator<const T> begin() const { return view().begin(); };
+  RowIterator<const T> end() const { return view().end(); };
+
+  // Non-owning views over the whole matrix or over a region of interest. They stay valid as long as the
+  // matrix is alive and not reassigned
+  MatrixView<T> view() { return MatrixView<T>(mat, rows, cols, stride); };
+  MatrixView<const T> view() const { return MatrixView<const T>(mat, rows, cols, stride); };
+  MatrixView<T> view(size_t row, size_t col, size_t sub_rows, size_t sub_cols)
+  {
+    return view().sub_view(row, col, sub_rows, sub_cols);
+  };
+  MatrixView<const T> view(size_t row, size_t col, size_t sub_rows, size_t sub_cols) const
+  {
+    return view().sub_view(row, col, sub_rows, sub_cols);
+  };
 };
 
 template<typename T>
@@ -63,41 +136,119 @@ Matrix<T>::Matrix()
   mat = nullptr;
   rows = 0;
   cols = 0;
+  stride = 0;
 }
 
 template<typename T>
-Matrix<T>::Matrix(size_t _rows, size_t _cols)
+Matrix<T>::Matrix(size_t _rows, size_t _cols, MatrixLayout layout)
+  : mat(nullptr)
 {
-  mat = new T[_rows * _cols];
-  rows = _rows;
-  cols = _cols;
+  size_t _stride = layout == MatrixLayout::ALIGNED_ROWS ? utils::aligned_stride(_cols, sizeof(T)) : _cols;
+  allocate(_rows, _cols, _stride);
 }
 
 template<typename T>
 Matrix<T>::Matrix(const Matrix<T>& rhs)
+  : mat(nullptr)
 {
-  rows = rhs.rows;
-  cols = rhs.cols;
-  mat = new T[rows * cols];
-  memcpy(mat, rhs.mat, sizeof(T) * rows * cols);
+  allocate(rhs.rows, rhs.cols, rhs.stride);
+  copy_from(rhs.mat, rhs.stride);
+}
+
+template<typename T>
+Matrix<T>::Matrix(Matrix<T>&& rhs) noexcept
+  : mat(rhs.mat)
+  , rows(rhs.rows)
+  , cols(rhs.cols)
+  , stride(rhs.stride)
+  , deleter(std::move(rhs.deleter))
+{
+  rhs.mat = nullptr;
+  rhs.rows = 0;
+  rhs.cols = 0;
+  rhs.stride = 0;
+  rhs.deleter = nullptr;
+}
+
+template<typename T>
+template<typename U, typename>
+Matrix<T>::Matrix(const MatrixView<U>& view)
+  : mat(nullptr)
+{
+  allocate(view.get_rows(), view.get_cols(), view.get_cols());
+  copy_from(view.data(), view.get_stride());
+}
+
+template<typename T>
+template<typename E>
+Matrix<T>::Matrix(const MatrixExpression<E>& expression, ExecutionMode mode)
+  : mat(nullptr)
+{
+  allocate(expression.self().get_rows(), expression.self().get_cols(), expression.self().get_cols());
+  evaluate(expression, view(), mode);
 }
 
 template<typename T>
 Matrix<T>::Matrix(size_t _rows, size_t _cols, T* buffer)
+  : mat(nullptr)
+{
+  allocate(_rows, _cols, _cols);
+  copy_from(buffer, _cols);
+}
+
+template<typename T>
+Matrix<T>::Matrix(size_t _rows, size_t _cols, T* buffer, std::function<void(T*)> _deleter, size_t _stride)
+  : mat(buffer)
+  , rows(_rows)
+  , cols(_cols)
+  , stride(_stride == 0 ? _cols : _stride)
+  , deleter(std::move(_deleter))
+{
+  // Without a deleter the matrix would not know how to release a buffer it did not allocate
+  assert(deleter);
+  assert(stride >= cols);
+}
+
+template<typename T>
+Matrix<T>::~Matrix()
+{
+  release();
+};
+
+template<typename T>
+void Matrix<T>::allocate(size_t _rows, size_t _cols, size_t _stride)
 {
   rows = _rows;
   cols = _cols;
-  mat = new T[rows * cols];
-  memcpy(mat, buffer, sizeof(T) * rows * cols);
+  stride = _stride;
+
+  size_t bytes = sizeof(T) * rows * stride;
+  mat = static_cast<T*>(utils::aligned_allocate(bytes));
+  deleter = [bytes](T* ptr) { utils::aligned_release(ptr, bytes); };
 }
 
+// Copy a buffer with the same number of rows and cols as this matrix
 template<typename T>
-Matrix<T>::~Matrix()
+void Matrix<T>::copy_from(const T* buffer, size_t buffer_stride)
 {
-  if (mat) {
-    delete[] mat;
+  if (stride == cols && buffer_stride == cols) {
+    memcpy(mat, buffer, sizeof(T) * rows * cols);
+    return;
   }
-};
+  for (size_t row = 0; row < rows; ++row) {
+    memcpy(mat + row * stride, buffer + row * buffer_stride, sizeof(T) * cols);
+  }
+}
+
+template<typename T>
+void Matrix<T>::release()
+{
+  if (mat && deleter) {
+    deleter(mat);
+  }
+  mat = nullptr;
+  deleter = nullptr;
+}
 
 // Assignment Operator
 template<typename T>
@@ -106,73 +257,59 @@ Matrix<T>& Matrix<T>::operator=(const Matrix<T>& rhs)
   if (&rhs == this)
     return *this;
 
-  if (mat) {
-    delete[] mat;
-  }
+  release();
 
-  rows = rhs.get_rows();
-  cols = rhs.get_cols();
-  mat = new T[rows * cols];
-  memcpy(mat, rhs.mat, sizeof(T) * rows * cols);
+  allocate(rhs.rows, rhs.cols, rhs.stride);
+  copy_from(rhs.mat, rhs.stride);
 
   return *this;
 }
 
-// Matrix mathematical Operator
+// Move assignment, the buffer (and its deleter) is stolen from rhs
 template<typename T>
-Matrix<T>& Matrix<T>::operator+(const Matrix<T>& rhs)
+Matrix<T>& Matrix<T>::operator=(Matrix<T>&& rhs) noexcept
 {
-  Matrix result(rows, cols, 0.0);
-
-  for (size_t i = 0; i < rows; i++) {
-    for (size_t j = 0; j < cols; j++) {
-      result(i, j) = this->operator()(i, j) + rhs(i, j);
-    }
-  }
+  if (&rhs == this)
+    return *this;
 
-  return result;
-}
+  release();
 
-template<typename T>
-Matrix<T>& Matrix<T>::operator-(const Matrix<T>& rhs)
-{
-  Matrix result(rows, cols, 0.0);
+  mat = rhs.mat;
+  rows = rhs.rows;
+  cols = rhs.cols;
+  stride = rhs.stride;
+  deleter = std::move(rhs.deleter);
 
-  for (size_t i = 0; i < rows; i++) {
-    for (size_t j = 0; j < cols; j++) {
-      result(i, j) = this->operator()(i, j) - rhs(i, j);
-    }
-  }
+  rhs.mat = nullptr;
+  rhs.rows = 0;
+  rhs.cols = 0;
+  rhs.stride = 0;
+  rhs.deleter = nullptr;
 
-  return result;
+  return *this;
 }
 
 template<typename T>
-Matrix<T>& Matrix<T>::operator*(const Matrix<T>& rhs)
+template<typename E>
+Matrix<T>& Matrix<T>::operator=(const MatrixExpression<E>& expression)
 {
-  Matrix result(rows, cols, 0.0);
-
-  for (size_t i = 0; i < rows; i++) {
-    for (size_t j = 0; j < cols; j++) {
-      result(i, j) = this->operator()(i, j) * rhs(i, j);
-    }
+  const E& expr = expression.self();
+  if (mat == nullptr || rows != expr.get_rows() || cols != expr.get_cols()) {
+    // Evaluate before releasing, the expression may still read the current buffer
+    return *this = Matrix<T>(expression);
   }
-
-  return result;
+  evaluate(expression, view());
+  return *this;
 }
 
+// Elementwise operations
 template<typename T>
 Matrix<T>& Matrix<T>::operator+=(const Matrix<T>& rhs)
 {
   assert(rows == rhs.get_rows());
   assert(cols == rhs.get_cols());
 
-  for (size_t i = 0; i < rows; i++) {
-    for (size_t j = 0; j < cols; j++) {
-      this->operator()(i, j) += rhs(i, j);
-    }
-  }
-
+  evaluate(*this + rhs, view());
   return *this;
 }
 
@@ -182,12 +319,7 @@ Matrix<T>& Matrix<T>::operator-=(const Matrix<T>& rhs)
   assert(rows == rhs.get_rows());
   assert(cols == rhs.get_cols());
 
-  for (size_t i = 0; i < rows; i++) {
-    for (size_t j = 0; j < cols; j++) {
-      this->operator()(i, j) -= rhs(i, j);
-    }
-  }
-
+  evaluate(*this - rhs, view());
   return *this;
 }
 
@@ -197,12 +329,7 @@ Matrix<T>& Matrix<T>::operator*=(const Matrix<T>& rhs)
   assert(rows == rhs.get_rows());
   assert(cols == rhs.get_cols());
 
-  for (size_t i = 0; i < rows; i++) {
-    for (size_t j = 0; j < cols; j++) {
-      this->operator()(i, j) *= rhs(i, j);
-    }
-  }
-
+  evaluate(*this * rhs, view());
   return *this;
 }
 
@@ -210,14 +337,22 @@ Matrix<T>& Matrix<T>::operator*=(const Matrix<T>& rhs)
 template<typename T>
 T& Matrix<T>::operator()(const size_t& row, const size_t& col)
 {
-  return this->mat[row * cols + col];
+  return this->mat[row * stride + col];
 }
 
 // Access the individual elements (const)
 template<typename T>
 const T& Matrix<T>::operator()(const size_t& row, const size_t& col) const
 {
-  return this->mat[row * cols + col];
+  return this->mat[row * stride + col];
+}
+
+template<typename T>
+void Matrix<T>::fill(const T& value)
+{
+  for (size_t row = 0; row < rows; ++row) {
+    std::fill(row_ptr(row), row_ptr(row) + cols, value);
+  }
 }
 
 // Get the number of rows of the matrix
@@ -234,78 +369,59 @@ size_t Matrix<T>::get_cols() const
   return this->cols;
 }
 
-template<typename T>
-Matrix<T> Matrix<T>::transpose()
-{
-  Matrix result(rows, cols, 0.0);
-
-  for (size_t i = 0; i < rows; i++) {
-    for (size_t j = 0; j < cols; j++) {
-      result(i, j) = this->mat[j][i];
-    }
-  }
-
-  return result;
-}
+// Side of the square tiles used by the transposition, a tile of each side (at most 2 * 4 KiB for 4 bytes
+// elements) stays in L1 while it is read by rows and written by columns
+const size_t TRANSPOSE_BLOCK_SIZE = 32;
 
-// Matrix/scalar addition
+// Transpose input into output, output must be input.get_cols() x input.get_rows() and must not overlap input
 template<typename T>
-Matrix<T> Matrix<T>::operator+(const T& rhs)
+void transpose(MatrixView<const T> input, MatrixView<T> output)
 {
-  Matrix result(rows, cols, 0.0);
-
-  for (size_t i = 0; i < rows; i++) {
-    for (size_t j = 0; j < cols; j++) {
-      result(i, j) = this->operator()(i, j) + rhs;
+  assert(output.get_rows() == input.get_cols() && output.get_cols() == input.get_rows());
+
+  for (size_t row_block = 0; row_block < input.get_rows(); row_block += TRANSPOSE_BLOCK_SIZE) {
+    size_t row_end = std::min(input.get_rows(), row_block + TRANSPOSE_BLOCK_SIZE);
+    for (size_t col_block = 0; col_block < input.get_cols(); col_block += TRANSPOSE_BLOCK_SIZE) {
+      size_t col_end = std::min(input.get_cols(), col_block + TRANSPOSE_BLOCK_SIZE);
+      for (size_t row = row_block; row < row_end; ++row) {
+        const T* input_row = input.row_ptr(row);
+        for (size_t col = col_block; col < col_end; ++col) {
+          output(col, row) = input_row[col];
+        }
+      }
     }
   }
-
-  return result;
 }
 
-// Matrix/scalar subtraction
 template<typename T>
-Matrix<T> Matrix<T>::operator-(const T& rhs)
+Matrix<T> Matrix<T>::transpose() const
 {
-  Matrix result(rows, cols, 0.0);
-
-  for (size_t i = 0; i < rows; i++) {
-    for (size_t j = 0; j < cols; j++) {
-      result(i, j) = this->operator()(i, j) - rhs;
-    }
-  }
-
+  Matrix<T> result(cols, rows);
+  ::transpose(view(), result.view());
   return result;
 }
 
-// Matrix/scalar multiplication
 template<typename T>
-Matrix<T> Matrix<T>::operator*(const T& rhs)
+void Matrix<T>::transpose_in_place()
 {
-  Matrix result(rows, cols, 0.0);
-
-  for (size_t i = 0; i < rows; i++) {
-    for (size_t j = 0; j < cols; j++) {
-      result(i, j) = this->operator()(i, j) * rhs;
-    }
+  if (rows != cols) {
+    *this = transpose();
+    return;
   }
 
-  return result;
-}
-
-// Matrix/scalar division
-template<typename T>
-Matrix<T> Matrix<T>::operator/(const T& rhs)
-{
-  Matrix result(rows, cols, 0.0);
-
-  for (size_t i = 0; i < rows; i++) {
-    for (size_t j = 0; j < cols; j++) {
-      result(i, j) = this->operator()(i, j) / rhs;
+  // Swap each tile above the diagonal with its mirror below it, diagonal tiles are swapped with themselves
+  for (size_t row_block = 0; row_block < rows; row_block += TRANSPOSE_BLOCK_SIZE) {
+    size_t row_end = std::min(rows, row_block + TRANSPOSE_BLOCK_SIZE);
+    for (size_t col_block = row_block; col_block < cols; col_block += TRANSPOSE_BLOCK_SIZE) {
+      size_t col_end = std::min(cols, col_block + TRANSPOSE_BLOCK_SIZE);
+      for (size_t row = row_block; row < row_end; ++row) {
+        T* row_data = row_ptr(row);
+        for (size_t col = std::max(col_block, row + 1); col < col_end; ++col) {
+          std::swap(row_data[col], operator()(col, row));
+        }
+      }
     }
   }
-
-  return result;
 }
 
 #endif // CAMERAAPP_MATRIX_H
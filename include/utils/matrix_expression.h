@@ -0,0 +1,275 @@
+#ifndef UTILS_MATRIX_EXPRESSION_H
+#define UTILS_MATRIX_EXPRESSION_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "utils/matrix_view.h"
+#include "utils/parallel.h"
+
+// Elementwise matrix algebra through expression templates.
+// Operators on matrices, views and scalars do not compute anything, they build a lightweight expression tree that is
+// evaluated in a single pass once it is assigned to a matrix (or explicitly evaluated into a view):
+//
+//   Matrix<uint8_t> res = (img - min) * scale + offset; // one loop, one allocation
+//
+// Expressions only keep pointers to the matrices they read, so they must not outlive them.
+
+template<typename T>
+class Matrix;
+
+enum class ExecutionMode
+{
+  SEQUENTIAL,
+  PARALLEL // rows are split in bands evaluated on the shared thread pool
+};
+
+template<typename E>
+struct MatrixExpression
+{
+  const E& self() const { return static_cast<const E&>(*this); };
+};
+
+// Leaf of every expression, reads an existing matrix or view
+template<typename T>
+class MatrixTerminal : public MatrixExpression<MatrixTerminal<T>>
+{
+public:
+  using value_type = T;
+
+  struct RowEvaluator
+  {
+    const T* row;
+    T operator[](size_t col) const { return row[col]; };
+  };
+
+  MatrixTerminal(const T* _ptr, size_t _rows, size_t _cols, size_t _stride)
+    : ptr(_ptr)
+    , rows(_rows)
+    , cols(_cols)
+    , stride(_stride){};
+
+  RowEvaluator row(size_t row) const { return RowEvaluator{ ptr + row * stride }; };
+  size_t get_rows() const { return rows; };
+  size_t get_cols() const { return cols; };
+
+private:
+  const T* ptr;
+  size_t rows, cols, stride;
+};
+
+// Scalars are broadcast, they report a 0x0 size so that they adapt to any matrix size
+template<typename S>
+class ScalarExpression : public MatrixExpression<ScalarExpression<S>>
+{
+public:
+  using value_type = S;
+
+  struct RowEvaluator
+  {
+    S value;
+    S operator[](size_t) const { return value; };
+  };
+
+  ScalarExpression(S _value)
+    : value(_value){};
+
+  RowEvaluator row(size_t) const { return RowEvaluator{ value }; };
+  size_t get_rows() const { return 0; };
+  size_t get_cols() const { return 0; };
+
+private:
+  S value;
+};
+
+template<typename L, typename R, typename Op>
+class BinaryExpression : public MatrixExpression<BinaryExpression<L, R, Op>>
+{
+public:
+  using value_type =
+    decltype(std::declval<Op>()(std::declval<typename L::value_type>(), std::declval<typename R::value_type>()));
+
+  struct RowEvaluator
+  {
+    typename L::RowEvaluator lhs;
+    typename R::RowEvaluator rhs;
+    Op op;
+    value_type operator[](size_t col) const { return op(lhs[col], rhs[col]); };
+  };
+
+  BinaryExpression(L _lhs, R _rhs, Op _op)
+    : lhs(_lhs)
+    , rhs(_rhs)
+    , op(_op)
+  {
+    assert(lhs.get_rows() == 0 || rhs.get_rows() == 0 || lhs.get_rows() == rhs.get_rows());
+    assert(lhs.get_cols() == 0 || rhs.get_cols() == 0 || lhs.get_cols() == rhs.get_cols());
+  };
+
+  RowEvaluator row(size_t row) const { return RowEvaluator{ lhs.row(row), rhs.row(row), op }; };
+  size_t get_rows() const { return std::max(lhs.get_rows(), rhs.get_rows()); };
+  size_t get_cols() const { return std::max(lhs.get_cols(), rhs.get_cols()); };
+
+private:
+  L lhs;
+  R rhs;
+  Op op;
+};
+
+// Elementwise if/else, picks if_true where the mask is non zero
+template<typename M, typename L, typename R>
+class SelectExpression : public MatrixExpression<SelectExpression<M, L, R>>
+{
+public:
+  using value_type = std::common_type_t<typename L::value_type, typename R::value_type>;
+
+  struct RowEvaluator
+  {
+    typename M::RowEvaluator mask;
+    typename L::RowEvaluator if_true;
+    typename R::RowEvaluator if_false;
+    value_type operator[](size_t col) const
+    {
+      return mask[col] ? value_type(if_true[col]) : value_type(if_false[col]);
+    };
+  };
+
+  SelectExpression(M _mask, L _if_true, R _if_false)
+    : mask(_mask)
+    , if_true(_if_true)
+    , if_false(_if_false){};
+
+  RowEvaluator row(size_t row) const { return RowEvaluator{ mask.row(row), if_true.row(row), if_false.row(row) }; };
+  size_t get_rows() const { return std::max({ mask.get_rows(), if_true.get_rows(), if_false.get_rows() }); };
+  size_t get_cols() const { return std::max({ mask.get_cols(), if_true.get_cols(), if_false.get_cols() }); };
+
+private:
+  M mask;
+  L if_true;
+  R if_false;
+};
+
+// ------------------------------------------------------------------------------------------------
+//                                     OPERANDS
+// ------------------------------------------------------------------------------------------------
+template<typename T>
+struct is_matrix_operand : std::is_base_of<MatrixExpression<T>, T>
+{};
+template<typename T>
+struct is_matrix_operand<Matrix<T>> : std::true_type
+{};
+template<typename T>
+struct is_matrix_operand<MatrixView<T>> : std::true_type
+{};
+
+// At least one matrix operand, the other one being a matrix operand or a scalar
+template<typename L, typename R>
+using enable_if_matrix_operands =
+  std::enable_if_t<(is_matrix_operand<L>::value && (is_matrix_operand<R>::value || std::is_arithmetic<R>::value)) ||
+                   (std::is_arithmetic<L>::value && is_matrix_operand<R>::value)>;
+
+template<typename T>
+MatrixTerminal<T> as_expression(const Matrix<T>& mat)
+{
+  return MatrixTerminal<T>(mat.data(), mat.get_rows(), mat.get_cols(), mat.get_stride());
+}
+
+template<typename T>
+MatrixTerminal<std::remove_const_t<T>> as_expression(const MatrixView<T>& view)
+{
+  return MatrixTerminal<std::remove_const_t<T>>(view.data(), view.get_rows(), view.get_cols(), view.get_stride());
+}
+
+template<typename E>
+E as_expression(const MatrixExpression<E>& expression)
+{
+  return expression.self();
+}
+
+template<typename S, typename = std::enable_if_t<std::is_arithmetic<S>::value>>
+ScalarExpression<S> as_expression(S value)
+{
+  return ScalarExpression<S>(value);
+}
+
+template<typename L, typename R, typename Op>
+auto make_binary_expression(const L& lhs, const R& rhs, Op op)
+{
+  using LE = decltype(as_expression(lhs));
+  using RE = decltype(as_expression(rhs));
+  return BinaryExpression<LE, RE, Op>(as_expression(lhs), as_expression(rhs), op);
+}
+
+// ------------------------------------------------------------------------------------------------
+//                                     OPERATORS
+// ------------------------------------------------------------------------------------------------
+template<typename L, typename R, typename = enable_if_matrix_operands<L, R>>
+auto operator+(const L& lhs, const R& rhs)
+{
+  return make_binary_expression(lhs, rhs, std::plus<>());
+}
+
+template<typename L, typename R, typename = enable_if_matrix_operands<L, R>>
+auto operator-(const L& lhs, const R& rhs)
+{
+  return make_binary_expression(lhs, rhs, std::minus<>());
+}
+
+template<typename L, typename R, typename = enable_if_matrix_operands<L, R>>
+auto operator*(const L& lhs, const R& rhs)
+{
+  return make_binary_expression(lhs, rhs, std::multiplies<>());
+}
+
+template<typename L, typename R, typename = enable_if_matrix_operands<L, R>>
+auto operator/(const L& lhs, const R& rhs)
+{
+  return make_binary_expression(lhs, rhs, std::divides<>());
+}
+
+template<typename M, typename L, typename R>
+auto select(const M& mask, const L& if_true, const R& if_false)
+{
+  using ME = decltype(as_expression(mask));
+  using LE = decltype(as_expression(if_true));
+  using RE = decltype(as_expression(if_false));
+  return SelectExpression<ME, LE, RE>(as_expression(mask), as_expression(if_true), as_expression(if_false));
+}
+
+// ------------------------------------------------------------------------------------------------
+//                                     EVALUATION
+// ------------------------------------------------------------------------------------------------
+// Evaluate an expression into an already allocated output. Output may alias any input, every element only depends on
+// the input elements at the same position
+template<typename T, typename E>
+void evaluate(const MatrixExpression<E>& expression,
+              MatrixView<T> output,
+              ExecutionMode mode = ExecutionMode::SEQUENTIAL)
+{
+  const E& expr = expression.self();
+  assert(expr.get_rows() == 0 || expr.get_rows() == output.get_rows());
+  assert(expr.get_cols() == 0 || expr.get_cols() == output.get_cols());
+
+  const size_t cols = output.get_cols();
+  auto evaluate_rows = [&expr, &output, cols](size_t row_begin, size_t row_end) {
+    for (size_t row = row_begin; row < row_end; ++row) {
+      const auto expr_row = expr.row(row);
+      T* output_row = output.row_ptr(row);
+      for (size_t col = 0; col < cols; ++col) {
+        output_row[col] = static_cast<T>(expr_row[col]);
+      }
+    }
+  };
+
+  if (mode == ExecutionMode::PARALLEL) {
+    utils::parallel_for(output.get_rows(), evaluate_rows);
+  } else {
+    evaluate_rows(0, output.get_rows());
+  }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+#ifndef UTILS_MATRIX_VIEW_H
+#define UTILS_MATRIX_VIEW_H
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+
+// Contiguous run of elements, typically one row of a matrix or a view. Loops over a span only deal with a base
+// pointer and an index, which keeps them simple enough for the compiler to hoist and vectorize
+template<typename T>
+class RowSpan
+{
+private:
+  T* ptr;
+  size_t length;
+
+public:
+  RowSpan(T* _ptr, size_t _length)
+    : ptr(_ptr)
+    , length(_length){};
+
+  // A mutable span can always be used where a read-only one is expected
+  template<typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+  RowSpan(const RowSpan<U>& rhs)
+    : ptr(rhs.data())
+    , length(rhs.size())
+  {
+  }
+
+  T& operator[](size_t idx) const { return ptr[idx]; };
+  T* data() const { return ptr; };
+  size_t size() const { return length; };
+
+  // Range-for support, iterates over the elements
+  T* begin() const { return ptr; };
+  T* end() const { return ptr + length; };
+};
+
+// Iterates over the rows of a view, one RowSpan at a time
+template<typename T>
+class RowIterator
+{
+private:
+  T* ptr;
+  size_t cols;
+  size_t stride;
+
+public:
+  RowIterator(T* _ptr, size_t _cols, size_t _stride)
+    : ptr(_ptr)
+    , cols(_cols)
+    , stride(_stride){};
+
+  RowSpan<T> operator*() const { return RowSpan<T>(ptr, cols); };
+  RowIterator& operator++()
+  {
+    ptr += stride;
+    return *this;
+  };
+  bool operator==(const RowIterator& rhs) const { return ptr == rhs.ptr; };
+  bool operator!=(const RowIterator& rhs) const { return ptr != rhs.ptr; };
+};
+
+// Non-owning window over a strided buffer (a whole Matrix, a region of interest, a tile...).
+// A view is cheap to copy and never outlives the memory it points to.
+template<typename T>
+class MatrixView
+{
+private:
+  T* ptr;
+  size_t rows;
+  size_t cols;
+  size_t stride;
+
+public:
+  MatrixView()
+    : ptr(nullptr)
+    , rows(0)
+    , cols(0)
+    , stride(0){};
+  MatrixView(T* _ptr, size_t _rows, size_t _cols, size_t _stride)
+    : ptr(_ptr)
+    , rows(_rows)
+    , cols(_cols)
+    , stride(_stride){};
+
+  // A mutable view can always be used where a read-only one is expected
+  template<typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+  MatrixView(const MatrixView<U>& rhs)
+    : ptr(rhs.data())
+    , rows(rhs.get_rows())
+    , cols(rhs.get_cols())
+    , stride(rhs.get_stride())
+  {
+  }
+
+  // Access the individual elements
+  T& operator()(const size_t& row, const size_t& col) const { return ptr[row * stride + col]; };
+  bool is_inside(const int& row, const int& col) const
+  {
+    return row >= 0 && col >= 0 && row < int(rows) && col < int(cols);
+  };
+
+  // Access a whole row, valid for indexes [0, get_cols())
+  T* row_ptr(const size_t& row) const { return ptr + row * stride; };
+  RowSpan<T> row(const size_t& row) const { return RowSpan<T>(ptr + row * stride, cols); };
+
+  // Range-for support, iterates over the rows: for (auto row : view) for (auto& pixel : row) ...
+  RowIterator<T> begin() const { return RowIterator<T>(ptr, cols, stride); };
+  RowIterator<T> end() const { return RowIterator<T>(ptr + rows * stride, cols, stride); };
+
+  // Region of interest, relative to this view
+  MatrixView<T> sub_view(size_t row, size_t col, size_t sub_rows, size_t sub_cols) const
+  {
+    assert(row + sub_rows <= rows && col + sub_cols <= cols);
+    return MatrixView<T>(ptr + row * stride + col, sub_rows, sub_cols, stride);
+  };
+
+  size_t get_rows() const { return rows; };
+  size_t get_cols() const { return cols; };
+  size_t get_stride() const { return stride; };
+  bool empty() const { return rows == 0 || cols == 0; };
+  T* data() const { return ptr; };
+};
+
+#endif
\ No newline at end of file
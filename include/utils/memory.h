@@ -0,0 +1,48 @@
+#ifndef UTILS_MEMORY_H
+#define UTILS_MEMORY_H
+
+#include <cstddef>
+
+namespace utils {
+// Alignment of every buffer allocated by Matrix, one cache line (and one AVX-512 register)
+const size_t MEMORY_ALIGNMENT = 64;
+
+// Buffers of at least this size are recycled through a process-wide pool instead of going back to the system.
+// Released buffers are kept in size classes (spaced by a quarter of a power of two) and handed out again to the
+// next allocation of the same class, so repeated pipeline runs do not page-fault fresh memory every time.
+// Recycled buffers are NOT zeroed.
+const size_t POOL_MIN_BYTES = 4096;
+const size_t DEFAULT_POOL_CAPACITY = size_t(1) << 30;
+
+// Very large buffers (multi-megapixel float intermediates) are mapped directly from the kernel and advised to use
+// transparent huge pages: one TLB entry covers 2 MiB instead of 4 KiB
+const size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+const size_t DEFAULT_HUGE_PAGE_THRESHOLD = size_t(8) << 20;
+
+struct AllocationPolicy
+{
+  // Buffers of at least this size are mmap-ed with huge pages, 0 disables it.
+  // Defaults to CVUI_HUGE_PAGE_THRESHOLD (in bytes) when the environment variable is set
+  size_t huge_page_threshold = DEFAULT_HUGE_PAGE_THRESHOLD;
+  // Fault the pages of mmap-ed buffers in at allocation time instead of on first touch inside a kernel.
+  // Defaults to true when CVUI_PREFAULT=1
+  bool prefault = false;
+};
+
+void set_allocation_policy(const AllocationPolicy& policy);
+AllocationPolicy get_allocation_policy();
+
+void* aligned_allocate(size_t bytes);
+void aligned_release(void* ptr, size_t bytes);
+
+// Maximum number of bytes kept in the pool, buffers released above it are freed. 0 disables the pool
+void set_buffer_pool_capacity(size_t bytes);
+size_t get_buffer_pool_cached_bytes();
+// Give every cached buffer back to the system
+void trim_buffer_pool();
+
+// Round a row size (in elements) up so that each row starts on a MEMORY_ALIGNMENT boundary
+size_t aligned_stride(size_t cols, size_t element_size);
+}
+
+#endif
\ No newline at end of file
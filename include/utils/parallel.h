@@ -0,0 +1,110 @@
+#ifndef UTILS_PARALLEL_H
+#define UTILS_PARALLEL_H
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utils/matrix_view.h"
+
+namespace utils {
+// Rows processed by a single task. Bands do not depend on the number of threads, so reductions give the same
+// result on every machine
+const size_t PARALLEL_GRAIN_ROWS = 16;
+
+// Persistent pool of worker threads shared by every image processing kernel
+class ThreadPool
+{
+public:
+  explicit ThreadPool(size_t n_threads);
+  ~ThreadPool();
+
+  // Number of threads taking part in a job, including the calling one
+  size_t get_thread_count() const { return workers.size() + 1; };
+
+  // Run task(index) for every index in [0, n_tasks) and wait for all of them. The calling thread takes part in the
+  // work. Nested calls (from inside a task) and concurrent calls run serially on the calling thread.
+  // Tasks must not throw
+  void run(size_t n_tasks, const std::function<void(size_t)>& task);
+
+private:
+  void worker_loop();
+  void execute_tasks();
+
+  std::vector<std::thread> workers;
+  std::mutex run_mutex;
+
+  std::mutex mutex;
+  std::condition_variable wake_condition;
+  std::condition_variable done_condition;
+  bool stopping = false;
+  uint64_t generation = 0;
+  size_t pending_workers = 0;
+
+  // Current job
+  const std::function<void(size_t)>* job = nullptr;
+  size_t job_size = 0;
+  std::atomic<size_t> next_task{ 0 };
+};
+
+// Pool sized after the hardware concurrency (or the CVUI_NUM_THREADS environment variable), created on first use
+ThreadPool& get_thread_pool();
+
+// Call body(row_begin, row_end) over consecutive bands of grain rows covering [0, rows)
+void parallel_for(size_t rows,
+                  const std::function<void(size_t, size_t)>& body,
+                  size_t grain = PARALLEL_GRAIN_ROWS);
+
+// output(row, col) = op(input(row, col))
+template<typename In, typename Out, typename Op>
+void transform(MatrixView<In> input, MatrixView<Out> output, Op op)
+{
+  assert(input.get_rows() == output.get_rows() && input.get_cols() == output.get_cols());
+  parallel_for(input.get_rows(), [&input, &output, &op](size_t row_begin, size_t row_end) {
+    for (size_t row = row_begin; row < row_end; ++row) {
+      const In* input_row = input.row_ptr(row);
+      Out* output_row = output.row_ptr(row);
+      for (size_t col = 0; col < input.get_cols(); ++col) {
+        output_row[col] = op(input_row[col]);
+      }
+    }
+  });
+}
+
+// reduce(init, transform(x)) over every element. Each band is reduced on its own, then the band results are folded
+// into init in row order: the result is deterministic, reduce only has to be associative
+template<typename T, typename R, typename Reduce, typename Transform>
+R transform_reduce(MatrixView<T> input, R init, Reduce reduce, Transform transform)
+{
+  if (input.empty()) {
+    return init;
+  }
+
+  size_t n_bands = (input.get_rows() + PARALLEL_GRAIN_ROWS - 1) / PARALLEL_GRAIN_ROWS;
+  std::vector<R> band_results(n_bands, init);
+  parallel_for(input.get_rows(), [&](size_t row_begin, size_t row_end) {
+    R acc = transform(input(row_begin, 0));
+    for (size_t row = row_begin; row < row_end; ++row) {
+      const T* input_row = input.row_ptr(row);
+      for (size_t col = row == row_begin ? 1 : 0; col < input.get_cols(); ++col) {
+        acc = reduce(acc, transform(input_row[col]));
+      }
+    }
+    band_results[row_begin / PARALLEL_GRAIN_ROWS] = acc;
+  });
+
+  R res = init;
+  for (const R& band_result : band_results) {
+    res = reduce(res, band_result);
+  }
+  return res;
+}
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef UTILS_PIXEL_TRAITS_H
+#define UTILS_PIXEL_TRAITS_H
+
+#include <algorithm>
+#include <cstdint>
+
+// Compile-time description of the single channel pixel formats the templated kernels are instantiated for
+// (uint8_t, uint16_t and float). Integer formats span their whole range, float images are expected in [0, 1]
+// but are never clamped so that intermediate results (gradients, responses...) keep their dynamic range.
+template<typename T>
+struct PixelTraits;
+
+template<>
+struct PixelTraits<uint8_t>
+{
+  static constexpr float max_value = 255.f;
+  // Clamp to the format range, then truncate like a plain cast
+  static uint8_t saturate(float value) { return uint8_t(std::min(std::max(value, 0.f), max_value)); };
+};
+
+template<>
+struct PixelTraits<uint16_t>
+{
+  static constexpr float max_value = 65535.f;
+  static uint16_t saturate(float value) { return uint16_t(std::min(std::max(value, 0.f), max_value)); };
+};
+
+template<>
+struct PixelTraits<float>
+{
+  static constexpr float max_value = 1.f;
+  static float saturate(float value) { return value; };
+};
+
+// Convert a value between two formats, the max value of one format maps to the max value of the other
+template<typename To, typename From>
+To convert_pixel(From value)
+{
+  return PixelTraits<To>::saturate(float(value) * (PixelTraits<To>::max_value / PixelTraits<From>::max_value));
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef UTILS_PLANAR_IMAGE_H
+#define UTILS_PLANAR_IMAGE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/matrix.h"
+
+// Planar (one uint8 plane per channel) counterpart of the packed Matrix<uint32_t> images.
+// Channel i holds the i-th byte of the packed pixel, starting from the most significant one: R, G, B, A for RGBA
+// images and H, S, V, A for HSVA ones. Per channel kernels can then walk contiguous rows.
+class PlanarImage
+{
+public:
+  static constexpr size_t N_CHANNELS = 4;
+  static constexpr size_t R = 0, G = 1, B = 2, A = 3;
+  static constexpr size_t H = 0, S = 1, V = 2;
+
+  PlanarImage(){};
+  PlanarImage(size_t rows, size_t cols)
+  {
+    for (auto& plane : planes) {
+      plane = Matrix<uint8_t>(rows, cols, MatrixLayout::ALIGNED_ROWS);
+    }
+  };
+
+  Matrix<uint8_t>& plane(size_t channel) { return planes[channel]; };
+  const Matrix<uint8_t>& plane(size_t channel) const { return planes[channel]; };
+
+  // Opaque alpha, for the filters that only compute the color planes
+  void fill_alpha()
+  {
+    Matrix<uint8_t>& alpha_plane = planes[A];
+    for (size_t row = 0; row < alpha_plane.get_rows(); ++row) {
+      std::fill(alpha_plane.row_ptr(row), alpha_plane.row_ptr(row) + alpha_plane.get_cols(), 255);
+    }
+  };
+
+  size_t get_rows() const { return planes[0].get_rows(); };
+  size_t get_cols() const { return planes[0].get_cols(); };
+
+private:
+  std::array<Matrix<uint8_t>, N_CHANNELS> planes;
+};
+
+#endif
\ No newline at end of file
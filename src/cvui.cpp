@@ -4,6 +4,7 @@
 #include <iostream>
 #include <memory>
 
+#include "image_processing/utils.h"
 #include "image_processing/zone_utils.h"
 
 static const int MARGIN = 10;
@@ -141,6 +142,9 @@ void CVUI::build_property_tree()
   register_processor("HSV transformations", hsv_processor);
   register_processor("Resizing", resizing_processor);
   register_processor("Gaussian blur", gaussian_blur_processor);
+  register_processor("Box filter", box_filter_processor);
+  register_processor("Median filter", median_filter_processor);
+  register_processor("Guided filter", guided_filter_processor);
   register_processor("Edge detection", edge_detection_processor);
   register_processor("Canny edge detection", canny_processor);
   register_processor("Image normalization", normalization_processor);
@@ -305,10 +309,15 @@ void CVUI::process_kmeans()
   // extract images
   Image rgba_img = context.get_image(filename);
   Image gray_img = context.get_image(framing_img_name);
-  auto sub_images = ip::extract_zone_images(rgba_img.rgba_img, gray_img.gray_img, 120);
+  auto zone_rois = ip::extract_zone_rois(rgba_img.rgba_img, gray_img.gray_img, 120);
   int i = 0;
-  for (const auto& sub_img : sub_images) {
-    Context::save_rgba_image_png(sub_img, "fragments/" + filename + std::to_string(i) + ".png");
+  for (const auto& roi : zone_rois) {
+    if (roi.rgba_view.empty()) {
+      ++i;
+      continue;
+    }
+    Context::save_rgba_image_png(
+      roi.rgba_view, "fragments/" + filename + std::to_string(i) + ".png", roi.zone_view, roi.zone_value);
     ++i;
   }
 
@@ -333,6 +342,10 @@ void CVUI::set_image_from_name(std::string img_name)
     pixbuf = utils::rgba_mat_to_pixbuf(img.rgba_img);
   } else if (img.type == ImageType::GRAY) {
     pixbuf = utils::gray_mat_to_pixbuf(img.gray_img);
+  } else if (img.type == ImageType::PLANAR) {
+    pixbuf = utils::rgba_mat_to_pixbuf(ip::planar_to_rgba(img.planar_img));
+  } else if (img.type == ImageType::GRAY16) {
+    pixbuf = utils::gray_mat_to_pixbuf(ip::convert_pixel_format<uint8_t>(img.gray16_img));
   } else {
     return;
   }
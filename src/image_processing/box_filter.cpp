@@ -0,0 +1,341 @@
+#include "image_processing/box_filter.h"
+
+#include "utils/parallel.h"
+#include "utils/pixel_traits.h"
+#include <algorithm>
+#include <vector>
+
+namespace ip {
+namespace {
+// Accumulators of the running sums, exact for the integer formats
+template<typename T>
+struct BoxSumTraits;
+
+template<>
+struct BoxSumTraits<uint8_t>
+{
+  using sum_type = uint32_t;
+  using square_sum_type = uint64_t;
+};
+
+template<>
+struct BoxSumTraits<uint16_t>
+{
+  using sum_type = uint64_t;
+  using square_sum_type = uint64_t;
+};
+
+template<>
+struct BoxSumTraits<float>
+{
+  using sum_type = double;
+  using square_sum_type = double;
+};
+
+// Rows summed by a vertical task, each task first sums the kernel_size - 1 rows above its band
+const size_t BOX_SUM_BAND_ROWS = 64;
+
+// sums(row, col) = sum of get(r, c) over the window of (row, col). Rows are summed first into an intermediate matrix,
+// then bands of rows slide a row of running sums down the image. Unsigned sums may wrap around in between, the
+// window sums themselves do not overflow
+template<typename Acc, typename Get>
+void box_sums(size_t rows, size_t cols, size_t kernel_size, BorderMode border_mode, Get get, MatrixView<Acc> sums)
+{
+  // Same anchor as apply_kernel, even windows reach one pixel further right and down
+  int offset = int((kernel_size - 1) / 2);
+  Matrix<Acc> row_sums(rows, cols);
+  utils::parallel_for(rows, [&](size_t row_begin, size_t row_end) {
+    std::vector<Acc> line(cols + kernel_size - 1);
+    for (size_t row = row_begin; row < row_end; ++row) {
+      // Only the margins go through border_index
+      auto read_margin = [&](size_t i) {
+        int col = border_index(int(i) - offset, int(cols), border_mode);
+        line[i] = col >= 0 ? get(row, size_t(col)) : Acc(0);
+      };
+      for (size_t i = 0; i < size_t(offset); ++i) {
+        read_margin(i);
+      }
+      for (size_t col = 0; col < cols; ++col) {
+        line[size_t(offset) + col] = get(row, col);
+      }
+      for (size_t i = size_t(offset) + cols; i < line.size(); ++i) {
+        read_margin(i);
+      }
+      Acc acc = Acc(0);
+      for (size_t i = 0; i + 1 < kernel_size; ++i) {
+        acc += line[i];
+      }
+      Acc* row_sums_row = row_sums.row_ptr(row);
+      for (size_t col = 0; col < cols; ++col) {
+        acc += line[col + kernel_size - 1];
+        row_sums_row[col] = acc;
+        acc -= line[col];
+      }
+    }
+  });
+
+  // Whole rows are read one after the other, which streams much better than narrow bands of columns
+  utils::parallel_for(
+    rows,
+    [&](size_t row_begin, size_t row_end) {
+      std::vector<Acc> acc(cols, Acc(0));
+      // Rows outside of a CONSTANT border are skipped
+      auto add_row = [&](int index) {
+        int row = border_index(index, int(rows), border_mode);
+        if (row >= 0) {
+          const Acc* row_sums_row = row_sums.row_ptr(size_t(row));
+          for (size_t col = 0; col < cols; ++col) {
+            acc[col] += row_sums_row[col];
+          }
+        }
+      };
+      auto sub_row = [&](int index) {
+        int row = border_index(index, int(rows), border_mode);
+        if (row >= 0) {
+          const Acc* row_sums_row = row_sums.row_ptr(size_t(row));
+          for (size_t col = 0; col < cols; ++col) {
+            acc[col] -= row_sums_row[col];
+          }
+        }
+      };
+
+      for (size_t i = 0; i + 1 < kernel_size; ++i) {
+        add_row(int(row_begin + i) - offset);
+      }
+      for (size_t row = row_begin; row < row_end; ++row) {
+        add_row(int(row + kernel_size - 1) - offset);
+        std::copy(acc.begin(), acc.end(), sums.row_ptr(row));
+        sub_row(int(row) - offset);
+      }
+    },
+    std::max(BOX_SUM_BAND_ROWS, kernel_size));
+}
+
+template<typename Sum, typename SquareSum>
+float variance_from_sums(Sum sum, SquareSum square_sum, double area)
+{
+  double mean = double(sum) / area;
+  return float(std::max(double(square_sum) / area - mean * mean, 0.));
+}
+}
+
+template<typename T>
+void box_filter(std::shared_ptr<Matrix<T>> input_img,
+                size_t kernel_size,
+                std::shared_ptr<Matrix<T>> output_img,
+                BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<T>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  box_filter<T>(input_img->view(), kernel_size, output_img->view(), border_mode);
+}
+
+template<typename T>
+void box_filter(MatrixView<const T> input_img, size_t kernel_size, MatrixView<T> output_img, BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+  if (input_img.empty() || kernel_size == 0) {
+    return;
+  }
+
+  using Sum = typename BoxSumTraits<T>::sum_type;
+  Matrix<Sum> sums(input_img.get_rows(), input_img.get_cols());
+  auto get = [&input_img](size_t row, size_t col) { return Sum(input_img(row, col)); };
+  box_sums<Sum>(input_img.get_rows(), input_img.get_cols(), kernel_size, border_mode, get, sums.view());
+
+  double area = double(kernel_size * kernel_size);
+  utils::transform(MatrixView<const Sum>(sums.view()), output_img, [area](Sum sum) {
+    return PixelTraits<T>::saturate(float(double(sum) / area));
+  });
+}
+
+template<typename T>
+void local_variance(std::shared_ptr<Matrix<T>> input_img,
+                    size_t kernel_size,
+                    std::shared_ptr<Matrix<float>> output_img,
+                    BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<float>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  local_variance<T>(input_img->view(), kernel_size, output_img->view(), border_mode);
+}
+
+template<typename T>
+void local_variance(MatrixView<const T> input_img,
+                    size_t kernel_size,
+                    MatrixView<float> output_img,
+                    BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+  if (input_img.empty() || kernel_size == 0) {
+    return;
+  }
+
+  using Sum = typename BoxSumTraits<T>::sum_type;
+  using SquareSum = typename BoxSumTraits<T>::square_sum_type;
+  size_t rows = input_img.get_rows(), cols = input_img.get_cols();
+  Matrix<Sum> sums(rows, cols);
+  Matrix<SquareSum> square_sums(rows, cols);
+  auto get = [&input_img](size_t row, size_t col) { return Sum(input_img(row, col)); };
+  auto get_square = [&input_img](size_t row, size_t col) {
+    SquareSum value = SquareSum(input_img(row, col));
+    return value * value;
+  };
+  box_sums<Sum>(rows, cols, kernel_size, border_mode, get, sums.view());
+  box_sums<SquareSum>(rows, cols, kernel_size, border_mode, get_square, square_sums.view());
+
+  double area = double(kernel_size * kernel_size);
+  utils::parallel_for(rows, [&](size_t row_begin, size_t row_end) {
+    for (size_t row = row_begin; row < row_end; ++row) {
+      const Sum* sums_row = sums.row_ptr(row);
+      const SquareSum* square_sums_row = square_sums.row_ptr(row);
+      float* output_row = output_img.row_ptr(row);
+      for (size_t col = 0; col < cols; ++col) {
+        output_row[col] = variance_from_sums(sums_row[col], square_sums_row[col], area);
+      }
+    }
+  });
+}
+
+#define INSTANTIATE_BOX_FILTER(T)                                                                                     \
+  template void box_filter<T>(std::shared_ptr<Matrix<T>>, size_t, std::shared_ptr<Matrix<T>>, BorderMode);            \
+  template void box_filter<T>(MatrixView<const T>, size_t, MatrixView<T>, BorderMode);                                 \
+  template void local_variance<T>(std::shared_ptr<Matrix<T>>, size_t, std::shared_ptr<Matrix<float>>, BorderMode);     \
+  template void local_variance<T>(MatrixView<const T>, size_t, MatrixView<float>, BorderMode);
+
+INSTANTIATE_BOX_FILTER(uint8_t)
+INSTANTIATE_BOX_FILTER(uint16_t)
+INSTANTIATE_BOX_FILTER(float)
+
+// RGBA
+void box_filter(std::shared_ptr<Matrix<uint32_t>> input_img,
+                size_t kernel_size,
+                std::shared_ptr<Matrix<uint32_t>> output_img,
+                BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<uint32_t>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  box_filter(input_img->view(), kernel_size, output_img->view(), border_mode);
+}
+
+void box_filter(MatrixView<const uint32_t> input_img,
+                size_t kernel_size,
+                MatrixView<uint32_t> output_img,
+                BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+  if (input_img.empty() || kernel_size == 0) {
+    return;
+  }
+
+  // Channels are summed one after the other, each of them ORed into the output
+  size_t rows = input_img.get_rows(), cols = input_img.get_cols();
+  Matrix<uint32_t> sums(rows, cols);
+  double area = double(kernel_size * kernel_size);
+  for (uint32_t shift : { 24u, 16u, 8u }) {
+    auto get = [&input_img, shift](size_t row, size_t col) { return (input_img(row, col) >> shift) & 0xff; };
+    box_sums<uint32_t>(rows, cols, kernel_size, border_mode, get, sums.view());
+    utils::parallel_for(rows, [&](size_t row_begin, size_t row_end) {
+      for (size_t row = row_begin; row < row_end; ++row) {
+        const uint32_t* sums_row = sums.row_ptr(row);
+        uint32_t* output_row = output_img.row_ptr(row);
+        for (size_t col = 0; col < cols; ++col) {
+          uint32_t value = uint32_t(PixelTraits<uint8_t>::saturate(float(double(sums_row[col]) / area))) << shift;
+          output_row[col] = shift == 24u ? (value | 255) : (output_row[col] | value);
+        }
+      }
+    });
+  }
+}
+
+// PLANAR
+void box_filter(std::shared_ptr<PlanarImage> input_img,
+                size_t kernel_size,
+                std::shared_ptr<PlanarImage> output_img,
+                BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = PlanarImage(input_img->get_rows(), input_img->get_cols());
+  }
+
+  for (size_t channel : { PlanarImage::R, PlanarImage::G, PlanarImage::B }) {
+    box_filter<uint8_t>(input_img->plane(channel).view(), kernel_size, output_img->plane(channel).view(), border_mode);
+  }
+  output_img->fill_alpha();
+}
+
+void local_variance(std::shared_ptr<Matrix<uint32_t>> input_img,
+                    size_t kernel_size,
+                    std::shared_ptr<Matrix<uint32_t>> output_img,
+                    BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<uint32_t>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  local_variance(input_img->view(), kernel_size, output_img->view(), border_mode);
+}
+
+void local_variance(MatrixView<const uint32_t> input_img,
+                    size_t kernel_size,
+                    MatrixView<uint32_t> output_img,
+                    BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+  if (input_img.empty() || kernel_size == 0) {
+    return;
+  }
+
+  size_t rows = input_img.get_rows(), cols = input_img.get_cols();
+  Matrix<uint32_t> sums(rows, cols);
+  Matrix<uint64_t> square_sums(rows, cols);
+  double area = double(kernel_size * kernel_size);
+  for (uint32_t shift : { 24u, 16u, 8u }) {
+    auto get = [&input_img, shift](size_t row, size_t col) { return (input_img(row, col) >> shift) & 0xff; };
+    auto get_square = [&input_img, shift](size_t row, size_t col) {
+      uint64_t value = (input_img(row, col) >> shift) & 0xff;
+      return value * value;
+    };
+    box_sums<uint32_t>(rows, cols, kernel_size, border_mode, get, sums.view());
+    box_sums<uint64_t>(rows, cols, kernel_size, border_mode, get_square, square_sums.view());
+    utils::parallel_for(rows, [&](size_t row_begin, size_t row_end) {
+      for (size_t row = row_begin; row < row_end; ++row) {
+        const uint32_t* sums_row = sums.row_ptr(row);
+        const uint64_t* square_sums_row = square_sums.row_ptr(row);
+        uint32_t* output_row = output_img.row_ptr(row);
+        for (size_t col = 0; col < cols; ++col) {
+          float variance = variance_from_sums(sums_row[col], square_sums_row[col], area);
+          uint32_t value = uint32_t(PixelTraits<uint8_t>::saturate(variance)) << shift;
+          output_row[col] = shift == 24u ? (value | 255) : (output_row[col] | value);
+        }
+      }
+    });
+  }
+}
+
+// PLANAR
+void local_variance(std::shared_ptr<PlanarImage> input_img,
+                    size_t kernel_size,
+                    std::shared_ptr<PlanarImage> output_img,
+                    BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = PlanarImage(input_img->get_rows(), input_img->get_cols());
+  }
+
+  Matrix<float> variance_img(input_img->get_rows(), input_img->get_cols());
+  for (size_t channel : { PlanarImage::R, PlanarImage::G, PlanarImage::B }) {
+    local_variance<uint8_t>(input_img->plane(channel).view(), kernel_size, variance_img.view(), border_mode);
+    utils::transform(MatrixView<const float>(variance_img.view()),
+                     output_img->plane(channel).view(),
+                     [](float value) { return PixelTraits<uint8_t>::saturate(value); });
+  }
+  output_img->fill_alpha();
+}
+}
\ No newline at end of file
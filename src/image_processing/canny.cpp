@@ -11,11 +11,7 @@
 CannyEdgeDetector::CannyEdgeDetector(float low_threshold, float high_threshold)
   : low_threshold(low_threshold)
   , high_threshold(high_threshold)
-{
-  gaussian_kernel = ip::create_gaussian_kernel(5, 1.f);
-  sobel_h = ip::create_sobel_h_kernel();
-  sobel_v = ip::create_sobel_v_kernel();
-}
+{}
 
 void CannyEdgeDetector::process_rgba_img(std::shared_ptr<Matrix<uint32_t>> rgba_img)
 {
@@ -29,13 +25,13 @@ void CannyEdgeDetector::process_gray_img(std::shared_ptr<Matrix<uint8_t>> gray_i
 
   // First step, apply blur on input image
   auto blurred_img = std::make_shared<Matrix<uint8_t>>(gray_img->get_rows(), gray_img->get_cols());
-  ip::apply_kernel(gray_img, gaussian_kernel, blurred_img);
+  ip::apply_kernel(gray_img, ip::GAUSSIAN_5X5_KERNEL, blurred_img);
 
-  // Second step, apply v and h sobel filters
+  // Second step, apply v and h sobel filters, both in a single pass over the blurred image
   edge_h = std::make_shared<Matrix<float>>(gray_img->get_rows(), gray_img->get_cols());
   edge_v = std::make_shared<Matrix<float>>(gray_img->get_rows(), gray_img->get_cols());
-  ip::apply_kernel(blurred_img, sobel_h, edge_h);
-  ip::apply_kernel(blurred_img, sobel_v, edge_v);
+  ip::apply_kernels<uint8_t, float>(
+    blurred_img, { ip::SOBEL_H_KERNEL.to_matrix(), ip::SOBEL_V_KERNEL.to_matrix() }, { edge_h, edge_v });
 
   // Third stap, extract magnitude and angle information from computed edges
   compute_edge_magnitude_and_angle();
@@ -53,10 +49,14 @@ void CannyEdgeDetector::compute_edge_magnitude_and_angle()
   edge_angle = std::make_shared<Matrix<float>>(gray_img->get_rows(), gray_img->get_cols());
 
   for (size_t row = 0; row < gray_img->get_rows(); row++) {
-    for (size_t col = 0; col < gray_img->get_cols(); col++) {
-      float gx = edge_h->operator()(row, col), gy = edge_v->operator()(row, col);
-      edge_magnitude->operator()(row, col) = std::floor(std::sqrt(std::pow(gx, 2) + std::pow(gy, 2)) + 0.5);
-      edge_angle->operator()(row, col) = std::atan(gy == 0.0 ? (gx / gy) : (1000 * gx));
+    RowSpan<const float> gx_row = edge_h->row(row);
+    RowSpan<const float> gy_row = edge_v->row(row);
+    RowSpan<float> magnitude_row = edge_magnitude->row(row);
+    RowSpan<float> angle_row = edge_angle->row(row);
+    for (size_t col = 0; col < gx_row.size(); col++) {
+      float gx = gx_row[col], gy = gy_row[col];
+      magnitude_row[col] = std::floor(std::sqrt(std::pow(gx, 2) + std::pow(gy, 2)) + 0.5);
+      angle_row[col] = std::atan(gy == 0.0 ? (gx / gy) : (1000 * gx));
     }
   }
 }
@@ -64,38 +64,33 @@ void CannyEdgeDetector::compute_edge_magnitude_and_angle()
 void CannyEdgeDetector::compute_raw_canny_edges()
 {
   raw_canny_edges = std::make_shared<Matrix<float>>(gray_img->get_rows(), gray_img->get_cols());
+  // The first and last rows and cols are never visited
+  raw_canny_edges->fill(0.f);
   for (size_t row = 1; row < gray_img->get_rows() - 1; row++) {
+    RowSpan<const float> prev_row = edge_magnitude->row(row - 1);
+    RowSpan<const float> magnitude_row = edge_magnitude->row(row);
+    RowSpan<const float> next_row = edge_magnitude->row(row + 1);
+    RowSpan<const float> angle_row = edge_angle->row(row);
+    RowSpan<float> raw_row = raw_canny_edges->row(row);
     for (size_t col = 1; col < gray_img->get_cols() - 1; col++) {
-      float alpha = edge_angle->operator()(row, col);
+      float alpha = angle_row[col];
+      float value = magnitude_row[col];
+      // Neighbors along the gradient direction
+      float before, after;
       if ((alpha < (M_PI / 8.0)) && (alpha > (-M_PI / 8.0))) {
-        if ((edge_magnitude->operator()(row, col) < edge_magnitude->operator()(row, col - 1)) ||
-            (edge_magnitude->operator()(row, col) < edge_magnitude->operator()(row, col + 1))) {
-          raw_canny_edges->operator()(row, col) = 0;
-        } else {
-          raw_canny_edges->operator()(row, col) = edge_magnitude->operator()(row, col);
-        }
+        before = magnitude_row[col - 1];
+        after = magnitude_row[col + 1];
       } else if ((alpha < (3 * M_PI / 8.0)) && (alpha > (M_PI / 8.0))) {
-        if ((edge_magnitude->operator()(row, col) < edge_magnitude->operator()(row - 1, col - 1)) ||
-            (edge_magnitude->operator()(row, col) < edge_magnitude->operator()(row + 1, col + 1))) {
-          raw_canny_edges->operator()(row, col) = 0;
-        } else {
-          raw_canny_edges->operator()(row, col) = edge_magnitude->operator()(row, col);
-        }
+        before = prev_row[col - 1];
+        after = next_row[col + 1];
       } else if ((alpha < (-M_PI / 8.0)) && (alpha > (-3 * M_PI / 8.0))) {
-        if ((edge_magnitude->operator()(row, col) < edge_magnitude->operator()(row + 1, col - 1)) ||
-            (edge_magnitude->operator()(row, col) < edge_magnitude->operator()(row - 1, col + 1))) {
-          raw_canny_edges->operator()(row, col) = 0;
-        } else {
-          raw_canny_edges->operator()(row, col) = edge_magnitude->operator()(row, col);
-        }
+        before = next_row[col - 1];
+        after = prev_row[col + 1];
       } else {
-        if ((edge_magnitude->operator()(row, col) < edge_magnitude->operator()(row + 1, col)) ||
-            (edge_magnitude->operator()(row, col) < edge_magnitude->operator()(row - 1, col))) {
-          raw_canny_edges->operator()(row, col) = 0;
-        } else {
-          raw_canny_edges->operator()(row, col) = edge_magnitude->operator()(row, col);
-        }
+        before = next_row[col];
+        after = prev_row[col];
       }
+      raw_row[col] = (value < before || value < after) ? 0 : value;
     }
   }
 }
@@ -110,14 +105,17 @@ void CannyEdgeDetector::threshold_raw_canny_edges()
   }
 
   canny_edges = std::make_shared<Matrix<uint8_t>>(gray_img->get_rows(), gray_img->get_cols());
+  canny_edges->fill(0);
   for (size_t row = 0; row < raw_canny_edges->get_rows(); row++) {
-    for (size_t col = 0; col < raw_canny_edges->get_cols(); col++) {
-      float edge_value = raw_canny_edges->operator()(row, col);
+    RowSpan<const float> raw_row = raw_canny_edges->row(row);
+    RowSpan<uint8_t> edges_row = canny_edges->row(row);
+    for (size_t col = 0; col < raw_row.size(); col++) {
+      float edge_value = raw_row[col];
       if (edge_value > high_threshold) {
-        canny_edges->operator()(row, col) = uint8_t(edge_value);
+        edges_row[col] = uint8_t(edge_value);
       } else if (edge_value >= low_threshold) {
         if (ip::get_max(ip::extract_neighborhood(raw_canny_edges, neighborhood_kernel, row, col)) > high_threshold) {
-          canny_edges->operator()(row, col) = uint8_t(edge_value);
+          edges_row[col] = uint8_t(edge_value);
         }
       }
     }
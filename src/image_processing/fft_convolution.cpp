@@ -0,0 +1,349 @@
+#include "image_processing/fft_convolution.h"
+
+#include "image_processing/spatial_filtering_simd.h"
+#include "utils/constants.h"
+#include "utils/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <memory>
+#include <mutex>
+
+namespace ip {
+namespace {
+// Columns transformed together by transform_2d, gathered in contiguous buffers
+const size_t FFT_COLUMN_BLOCK = 16;
+// Tile sizes, a tile is about four times the kernel size so that most of its pixels are valid outputs
+const size_t FFT_MIN_SIZE = 64;
+const size_t FFT_MAX_SIZE = 1024;
+// Tiles sharing the work buffers of a task, two of them fill the real and imaginary parts of the transforms
+const size_t FFT_TILES_PER_TASK = 2;
+
+// std::complex multiplication handles infinities and NaNs, which makes it much slower
+std::complex<float> multiply(std::complex<float> lhs, std::complex<float> rhs)
+{
+  return std::complex<float>(lhs.real() * rhs.real() - lhs.imag() * rhs.imag(),
+                             lhs.real() * rhs.imag() + lhs.imag() * rhs.real());
+}
+
+size_t next_power_of_two(size_t value)
+{
+  size_t power = 1;
+  while (power < value) {
+    power <<= 1;
+  }
+  return power;
+}
+
+size_t choose_fft_size(const Matrix<float>& kernel, size_t rows, size_t cols)
+{
+  size_t kernel_size = std::max(kernel.get_rows(), kernel.get_cols());
+  size_t fft_size = std::min(std::max(next_power_of_two(4 * kernel_size), FFT_MIN_SIZE), FFT_MAX_SIZE);
+  fft_size = std::max(fft_size, next_power_of_two(2 * kernel_size));
+  // No need for tiles larger than the (padded) image
+  size_t padded_size = std::max(rows + kernel.get_rows(), cols + kernel.get_cols()) - 1;
+  return std::min(fft_size, next_power_of_two(padded_size));
+}
+
+// Spectrum of a kernel for a tile size. The kernel is flipped and centered on (0, 0) so that the circular convolution
+// computes the correlation, and the 1 / size^2 normalization of the inverse transform is folded into it
+struct FftKernel
+{
+  size_t rows, cols;
+  std::vector<float> coefficients;
+  FftPlan plan;
+  std::vector<std::complex<float>> spectrum;
+
+  FftKernel(const Matrix<float>& kernel, size_t fft_size)
+    : rows(kernel.get_rows())
+    , cols(kernel.get_cols())
+    , plan(fft_size)
+    , spectrum(fft_size * fft_size)
+  {
+    float normalization = 1.f / float(fft_size * fft_size);
+    size_t kernel_semi_rows = (rows - 1) / 2;
+    size_t kernel_semi_cols = (cols - 1) / 2;
+    for (size_t x = 0; x < rows; ++x) {
+      for (size_t y = 0; y < cols; ++y) {
+        coefficients.push_back(kernel(x, y));
+        size_t row = (kernel_semi_rows + fft_size - x) % fft_size;
+        size_t col = (kernel_semi_cols + fft_size - y) % fft_size;
+        spectrum[row * fft_size + col] = kernel(x, y) * normalization;
+      }
+    }
+    plan.transform_2d(spectrum.data(), false);
+  };
+
+  bool matches(const Matrix<float>& kernel, size_t fft_size) const
+  {
+    if (kernel.get_rows() != rows || kernel.get_cols() != cols || plan.get_size() != fft_size) {
+      return false;
+    }
+    for (size_t x = 0; x < rows; ++x) {
+      if (!std::equal(kernel.row_ptr(x), kernel.row_ptr(x) + cols, coefficients.data() + x * cols)) {
+        return false;
+      }
+    }
+    return true;
+  };
+};
+
+// Most recently used first
+std::mutex fft_kernel_cache_mutex;
+std::list<std::shared_ptr<const FftKernel>> fft_kernel_cache;
+
+std::shared_ptr<const FftKernel> get_fft_kernel(const Matrix<float>& kernel, size_t fft_size)
+{
+  {
+    std::lock_guard<std::mutex> lock(fft_kernel_cache_mutex);
+    for (auto it = fft_kernel_cache.begin(); it != fft_kernel_cache.end(); ++it) {
+      if ((*it)->matches(kernel, fft_size)) {
+        fft_kernel_cache.splice(fft_kernel_cache.begin(), fft_kernel_cache, it);
+        return fft_kernel_cache.front();
+      }
+    }
+  }
+
+  // Transformed outside of the lock, concurrent misses on the same kernel only cost a duplicate transform
+  auto fft_kernel = std::make_shared<const FftKernel>(kernel, fft_size);
+  std::lock_guard<std::mutex> lock(fft_kernel_cache_mutex);
+  fft_kernel_cache.push_front(fft_kernel);
+  if (fft_kernel_cache.size() > FFT_KERNEL_CACHE_SIZE) {
+    fft_kernel_cache.pop_back();
+  }
+  return fft_kernel;
+}
+
+// Channels of a pixel format, as float planes
+template<typename T>
+struct FftChannels
+{
+  static const size_t count = 1;
+  static float get(T pixel, size_t) { return float(pixel); };
+};
+
+template<>
+struct FftChannels<uint32_t>
+{
+  static const size_t count = 3;
+  static float get(uint32_t pixel, size_t channel) { return float((pixel >> (24 - 8 * channel)) & 0xff); };
+};
+
+// store(output_row, channel_rows, size) converts size responses of every channel to output pixels
+template<typename In, typename Out, typename Store>
+void correlate_fft(MatrixView<const In> input_img,
+                   const Matrix<float>& kernel,
+                   MatrixView<Out> output_img,
+                   BorderMode border_mode,
+                   Store store)
+{
+  const size_t n_channels = FftChannels<In>::count;
+  size_t rows = input_img.get_rows();
+  size_t cols = input_img.get_cols();
+  if (rows == 0 || cols == 0) {
+    return;
+  }
+  size_t fft_size = choose_fft_size(kernel, rows, cols);
+  auto fft_kernel = get_fft_kernel(kernel, fft_size);
+
+  // Valid outputs of a tile, the other ones are polluted by the circular wrap
+  size_t block_rows = fft_size - kernel.get_rows() + 1;
+  size_t block_cols = fft_size - kernel.get_cols() + 1;
+  size_t n_tile_cols = (cols + block_cols - 1) / block_cols;
+  size_t n_tiles = ((rows + block_rows - 1) / block_rows) * n_tile_cols;
+  int kernel_semi_rows = (int(kernel.get_rows()) - 1) / 2;
+  int kernel_semi_cols = (int(kernel.get_cols()) - 1) / 2;
+
+  size_t n_tasks = (n_tiles + FFT_TILES_PER_TASK - 1) / FFT_TILES_PER_TASK;
+  utils::get_thread_pool().run(n_tasks, [&](size_t task) {
+    size_t first_tile = task * FFT_TILES_PER_TASK;
+    size_t n_planes = std::min(FFT_TILES_PER_TASK, n_tiles - first_tile) * n_channels;
+    std::vector<std::complex<float>> data(fft_size * fft_size);
+    std::vector<float> responses(n_planes * block_rows * block_cols);
+    std::vector<int> row_indices(fft_size), col_indices(fft_size);
+
+    // Two real planes per transform, the kernel being real their responses come back in the real and imaginary parts
+    for (size_t first_plane = 0; first_plane < n_planes; first_plane += 2) {
+      std::fill(data.begin(), data.end(), std::complex<float>(0.f, 0.f));
+      float* parts = reinterpret_cast<float*>(data.data());
+      for (size_t plane = first_plane; plane < std::min(first_plane + 2, n_planes); ++plane) {
+        size_t tile = first_tile + plane / n_channels;
+        int tile_row = int((tile / n_tile_cols) * block_rows) - kernel_semi_rows;
+        int tile_col = int((tile % n_tile_cols) * block_cols) - kernel_semi_cols;
+        for (size_t i = 0; i < fft_size; ++i) {
+          row_indices[i] = border_index(tile_row + int(i), rows, border_mode);
+          col_indices[i] = border_index(tile_col + int(i), cols, border_mode);
+        }
+        size_t part = plane - first_plane;
+        for (size_t i = 0; i < fft_size; ++i) {
+          if (row_indices[i] < 0) {
+            continue;
+          }
+          const In* input_row = input_img.row_ptr(row_indices[i]);
+          float* data_row = parts + 2 * i * fft_size;
+          for (size_t j = 0; j < fft_size; ++j) {
+            if (col_indices[j] >= 0) {
+              data_row[2 * j + part] = FftChannels<In>::get(input_row[col_indices[j]], plane % n_channels);
+            }
+          }
+        }
+      }
+
+      fft_kernel->plan.transform_2d(data.data(), false);
+      for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = multiply(data[i], fft_kernel->spectrum[i]);
+      }
+      fft_kernel->plan.transform_2d(data.data(), true);
+
+      for (size_t plane = first_plane; plane < std::min(first_plane + 2, n_planes); ++plane) {
+        size_t part = plane - first_plane;
+        float* response = responses.data() + plane * block_rows * block_cols;
+        for (size_t i = 0; i < block_rows; ++i) {
+          const float* data_row = parts + 2 * ((i + kernel_semi_rows) * fft_size + kernel_semi_cols);
+          for (size_t j = 0; j < block_cols; ++j) {
+            response[i * block_cols + j] = data_row[2 * j + part];
+          }
+        }
+      }
+    }
+
+    const float* channel_rows[n_channels];
+    for (size_t tile = first_tile; tile < first_tile + n_planes / n_channels; ++tile) {
+      size_t tile_row = (tile / n_tile_cols) * block_rows;
+      size_t tile_col = (tile % n_tile_cols) * block_cols;
+      const float* response = responses.data() + (tile - first_tile) * n_channels * block_rows * block_cols;
+      for (size_t i = 0; i < std::min(block_rows, rows - tile_row); ++i) {
+        for (size_t channel = 0; channel < n_channels; ++channel) {
+          channel_rows[channel] = response + (channel * block_rows + i) * block_cols;
+        }
+        store(output_img.row_ptr(tile_row + i) + tile_col, channel_rows, std::min(block_cols, cols - tile_col));
+      }
+    }
+  });
+}
+}
+
+FftPlan::FftPlan(size_t _size)
+  : size(_size)
+  , bit_reversal(_size)
+  , twiddles(_size / 2)
+{
+  assert(size > 0 && (size & (size - 1)) == 0);
+  size_t n_bits = 0;
+  while ((size_t(1) << n_bits) < size) {
+    ++n_bits;
+  }
+  for (size_t i = 0; i < size; ++i) {
+    size_t reversed = 0;
+    for (size_t bit = 0; bit < n_bits; ++bit) {
+      reversed |= ((i >> bit) & 1) << (n_bits - 1 - bit);
+    }
+    bit_reversal[i] = reversed;
+  }
+  // Computed in double, the float rounding of the twiddles is the main source of error
+  for (size_t k = 0; k < size / 2; ++k) {
+    double angle = -2. * M_PI * double(k) / double(size);
+    twiddles[k] = std::complex<float>(float(std::cos(angle)), float(std::sin(angle)));
+  }
+}
+
+void FftPlan::transform(std::complex<float>* data, bool inverse) const
+{
+  for (size_t i = 0; i < size; ++i) {
+    if (i < bit_reversal[i]) {
+      std::swap(data[i], data[bit_reversal[i]]);
+    }
+  }
+  // Iterative Cooley-Tukey butterflies
+  for (size_t length = 2; length <= size; length <<= 1) {
+    size_t half_length = length / 2;
+    size_t twiddle_step = size / length;
+    for (size_t start = 0; start < size; start += length) {
+      for (size_t j = 0; j < half_length; ++j) {
+        std::complex<float> twiddle = twiddles[j * twiddle_step];
+        if (inverse) {
+          twiddle = std::conj(twiddle);
+        }
+        std::complex<float> even = data[start + j];
+        std::complex<float> odd = multiply(data[start + j + half_length], twiddle);
+        data[start + j] = even + odd;
+        data[start + j + half_length] = even - odd;
+      }
+    }
+  }
+}
+
+void FftPlan::transform_2d(std::complex<float>* data, bool inverse) const
+{
+  for (size_t row = 0; row < size; ++row) {
+    transform(data + row * size, inverse);
+  }
+
+  size_t block = std::min(size, FFT_COLUMN_BLOCK);
+  std::vector<std::complex<float>> columns(block * size);
+  for (size_t first_col = 0; first_col < size; first_col += block) {
+    for (size_t row = 0; row < size; ++row) {
+      for (size_t col = 0; col < block; ++col) {
+        columns[col * size + row] = data[row * size + first_col + col];
+      }
+    }
+    for (size_t col = 0; col < block; ++col) {
+      transform(columns.data() + col * size, inverse);
+    }
+    for (size_t row = 0; row < size; ++row) {
+      for (size_t col = 0; col < block; ++col) {
+        data[row * size + first_col + col] = columns[col * size + row];
+      }
+    }
+  }
+}
+
+bool use_fft_convolution(const Matrix<float>& kernel, bool separable)
+{
+  if (separable) {
+    return std::min(kernel.get_rows(), kernel.get_cols()) >= FFT_SEPARABLE_KERNEL_SIZE;
+  }
+  return kernel.get_rows() * kernel.get_cols() >= FFT_KERNEL_AREA_THRESHOLD;
+}
+
+template<typename In, typename Out>
+void apply_kernel_fft(MatrixView<const In> input_img,
+                      const Matrix<float>& kernel,
+                      MatrixView<Out> output_img,
+                      BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+
+  correlate_fft(input_img, kernel, output_img, border_mode, [](Out* output_row, const float** responses, size_t size) {
+    simd::store_row(responses[0], output_row, size);
+  });
+}
+
+void apply_kernel_fft(MatrixView<const uint32_t> input_img,
+                      const Matrix<float>& kernel,
+                      MatrixView<uint32_t> output_img,
+                      BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+
+  correlate_fft(
+    input_img, kernel, output_img, border_mode, [](uint32_t* output_row, const float** responses, size_t size) {
+      simd::store_rgba_row(responses[0], responses[1], responses[2], output_row, size);
+    });
+}
+
+void clear_fft_kernel_cache()
+{
+  std::lock_guard<std::mutex> lock(fft_kernel_cache_mutex);
+  fft_kernel_cache.clear();
+}
+
+#define INSTANTIATE_APPLY_KERNEL_FFT(In, Out)                                                                         \
+  template void apply_kernel_fft<In, Out>(MatrixView<const In>, const Matrix<float>&, MatrixView<Out>, BorderMode);
+
+INSTANTIATE_APPLY_KERNEL_FFT(uint8_t, uint8_t)
+INSTANTIATE_APPLY_KERNEL_FFT(uint16_t, uint16_t)
+INSTANTIATE_APPLY_KERNEL_FFT(float, float)
+INSTANTIATE_APPLY_KERNEL_FFT(uint8_t, float)
+INSTANTIATE_APPLY_KERNEL_FFT(uint16_t, float)
+}
\ No newline at end of file
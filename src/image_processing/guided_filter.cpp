@@ -0,0 +1,345 @@
+#include "image_processing/guided_filter.h"
+
+#include "image_processing/box_filter.h"
+#include "utils/parallel.h"
+#include "utils/pixel_traits.h"
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+namespace ip {
+namespace {
+// Keeps a / (var + epsilon) finite over flat windows
+const float GUIDED_FILTER_MIN_EPSILON = 1e-6f;
+
+using Planes = std::vector<Matrix<float>>;
+
+// Box means over the windows of the filter
+class BoxMean
+{
+public:
+  BoxMean(size_t rows, size_t cols, size_t radius, BorderMode _border_mode)
+    : kernel_size(2 * radius + 1)
+    , border_mode(_border_mode)
+  {
+    // box_filter divides CONSTANT sums by the whole window, they are rescaled by the share of the window inside the
+    // image
+    if (border_mode == BorderMode::CONSTANT) {
+      Matrix<float> ones(rows, cols);
+      for (size_t row = 0; row < rows; ++row) {
+        std::fill(ones.row_ptr(row), ones.row_ptr(row) + cols, 1.f);
+      }
+      scales = Matrix<float>(rows, cols);
+      box_filter<float>(ones.view(), kernel_size, scales.view(), border_mode);
+      evaluate(1.f / scales, scales.view(), ExecutionMode::PARALLEL);
+    }
+  };
+
+  Matrix<float> operator()(const Matrix<float>& input) const
+  {
+    Matrix<float> output(input.get_rows(), input.get_cols());
+    box_filter<float>(input.view(), kernel_size, output.view(), border_mode);
+    if (border_mode == BorderMode::CONSTANT) {
+      evaluate(output * scales, output.view(), ExecutionMode::PARALLEL);
+    }
+    return output;
+  };
+
+private:
+  size_t kernel_size;
+  BorderMode border_mode;
+  Matrix<float> scales;
+};
+
+// Filter every plane in place, the guide has a single channel. A self guided plane reuses the statistics of the guide
+void guide_with_gray(const Matrix<float>& guide,
+                     Planes& planes,
+                     bool self_guided,
+                     const BoxMean& box_mean,
+                     float epsilon)
+{
+  Matrix<float> mean_guide = box_mean(guide);
+  Matrix<float> variance = box_mean(Matrix<float>(guide * guide, ExecutionMode::PARALLEL));
+  evaluate(variance - mean_guide * mean_guide, variance.view(), ExecutionMode::PARALLEL);
+
+  for (auto& plane : planes) {
+    // a = cov(I, p) / (var(I) + epsilon), b = mean(p) - a * mean(I)
+    Matrix<float> a = variance;
+    Matrix<float> b = mean_guide;
+    if (!self_guided) {
+      b = box_mean(plane);
+      a = box_mean(Matrix<float>(guide * plane, ExecutionMode::PARALLEL));
+      evaluate(a - mean_guide * b, a.view(), ExecutionMode::PARALLEL);
+    }
+    evaluate(a / (variance + epsilon), a.view(), ExecutionMode::PARALLEL);
+    evaluate(b - a * mean_guide, b.view(), ExecutionMode::PARALLEL);
+
+    Matrix<float> mean_a = box_mean(a);
+    Matrix<float> mean_b = box_mean(b);
+    evaluate(mean_a * guide + mean_b, plane.view(), ExecutionMode::PARALLEL);
+  }
+}
+
+// Entries of the symmetric 3x3 covariance of the guide channels, and the entry of every (channel, channel) pair
+const size_t COVARIANCE_PAIRS[6][2] = { { 0, 0 }, { 0, 1 }, { 0, 2 }, { 1, 1 }, { 1, 2 }, { 2, 2 } };
+const size_t COVARIANCE_INDEX[3][3] = { { 0, 1, 2 }, { 1, 3, 4 }, { 2, 4, 5 } };
+
+// Filter every plane in place, the guide has three color channels. Self guided planes are the channels of the guide,
+// their covariances with the guide are already known
+void guide_with_color(const Planes& guide,
+                      Planes& planes,
+                      bool self_guided,
+                      const BoxMean& box_mean,
+                      float epsilon)
+{
+  Planes mean_guide;
+  for (const auto& channel : guide) {
+    mean_guide.push_back(box_mean(channel));
+  }
+  Planes covariances;
+  for (const auto& pair : COVARIANCE_PAIRS) {
+    covariances.push_back(box_mean(Matrix<float>(guide[pair[0]] * guide[pair[1]], ExecutionMode::PARALLEL)));
+    evaluate(covariances.back() - mean_guide[pair[0]] * mean_guide[pair[1]],
+             covariances.back().view(),
+             ExecutionMode::PARALLEL);
+  }
+
+  // (covariance + epsilon * identity)^-1 through the adjugate, one elementwise pass per entry
+  auto rr = covariances[0] + epsilon;
+  auto gg = covariances[3] + epsilon;
+  auto bb = covariances[5] + epsilon;
+  const Matrix<float>& rg = covariances[1];
+  const Matrix<float>& rb = covariances[2];
+  const Matrix<float>& gb = covariances[4];
+  Planes inverses;
+  inverses.reserve(6);
+  inverses.emplace_back(gg * bb - gb * gb, ExecutionMode::PARALLEL);
+  inverses.emplace_back(rb * gb - rg * bb, ExecutionMode::PARALLEL);
+  inverses.emplace_back(rg * gb - rb * gg, ExecutionMode::PARALLEL);
+  Matrix<float> inverse_det(1.f / (rr * inverses[0] + rg * inverses[1] + rb * inverses[2]), ExecutionMode::PARALLEL);
+  inverses.emplace_back((rr * bb - rb * rb) * inverse_det, ExecutionMode::PARALLEL);
+  inverses.emplace_back((rb * rg - rr * gb) * inverse_det, ExecutionMode::PARALLEL);
+  inverses.emplace_back((rr * gg - rg * rg) * inverse_det, ExecutionMode::PARALLEL);
+  for (size_t i = 0; i < 3; ++i) {
+    evaluate(inverses[i] * inverse_det, inverses[i].view(), ExecutionMode::PARALLEL);
+  }
+  auto inverse = [&inverses](size_t first, size_t second) -> const Matrix<float>& {
+    return inverses[COVARIANCE_INDEX[first][second]];
+  };
+
+  for (size_t plane_index = 0; plane_index < planes.size(); ++plane_index) {
+    Matrix<float>& plane = planes[plane_index];
+    // cov(I, p) for every channel of the guide
+    Planes plane_covariances;
+    const Matrix<float>* covariance[3];
+    Matrix<float> mean_plane;
+    if (self_guided) {
+      mean_plane = mean_guide[plane_index];
+      for (size_t channel = 0; channel < 3; ++channel) {
+        covariance[channel] = &covariances[COVARIANCE_INDEX[channel][plane_index]];
+      }
+    } else {
+      mean_plane = box_mean(plane);
+      for (size_t channel = 0; channel < 3; ++channel) {
+        plane_covariances.push_back(box_mean(Matrix<float>(guide[channel] * plane, ExecutionMode::PARALLEL)));
+        evaluate(plane_covariances[channel] - mean_guide[channel] * mean_plane,
+                 plane_covariances[channel].view(),
+                 ExecutionMode::PARALLEL);
+      }
+      for (size_t channel = 0; channel < 3; ++channel) {
+        covariance[channel] = &plane_covariances[channel];
+      }
+    }
+
+    // a = (cov(I) + epsilon * identity)^-1 cov(I, p), b = mean(p) - a . mean(I)
+    Planes a;
+    for (size_t channel = 0; channel < 3; ++channel) {
+      a.emplace_back(inverse(channel, 0) * *covariance[0] + inverse(channel, 1) * *covariance[1] +
+                       inverse(channel, 2) * *covariance[2],
+                     ExecutionMode::PARALLEL);
+    }
+    Matrix<float> b(mean_plane - (a[0] * mean_guide[0] + a[1] * mean_guide[1] + a[2] * mean_guide[2]),
+                    ExecutionMode::PARALLEL);
+
+    for (auto& coefficients : a) {
+      coefficients = box_mean(coefficients);
+    }
+    Matrix<float> mean_b = box_mean(b);
+    evaluate(a[0] * guide[0] + a[1] * guide[1] + a[2] * guide[2] + mean_b, plane.view(), ExecutionMode::PARALLEL);
+  }
+}
+
+// Intensities scaled to [0, 1], one plane per color channel
+Planes to_planes(MatrixView<const uint8_t> img)
+{
+  Planes planes;
+  planes.emplace_back(img.get_rows(), img.get_cols());
+  utils::transform(img, planes.back().view(), [](uint8_t value) { return float(value) / 255.f; });
+  return planes;
+}
+
+Planes to_planes(MatrixView<const uint32_t> img)
+{
+  Planes planes;
+  for (uint32_t shift : { 24u, 16u, 8u }) {
+    planes.emplace_back(img.get_rows(), img.get_cols());
+    utils::transform(
+      img, planes.back().view(), [shift](uint32_t value) { return float((value >> shift) & 0xff) / 255.f; });
+  }
+  return planes;
+}
+
+uint8_t to_pixel(float value)
+{
+  return PixelTraits<uint8_t>::saturate(value * 255.f + 0.5f);
+}
+
+void from_planes(const Planes& planes, MatrixView<uint8_t> img)
+{
+  utils::transform(planes[0].view(), img, to_pixel);
+}
+
+void from_planes(const Planes& planes, MatrixView<uint32_t> img)
+{
+  utils::parallel_for(img.get_rows(), [&planes, &img](size_t row_begin, size_t row_end) {
+    for (size_t row = row_begin; row < row_end; ++row) {
+      const float* r_row = planes[0].row_ptr(row);
+      const float* g_row = planes[1].row_ptr(row);
+      const float* b_row = planes[2].row_ptr(row);
+      uint32_t* img_row = img.row_ptr(row);
+      for (size_t col = 0; col < img.get_cols(); ++col) {
+        img_row[col] = (uint32_t(to_pixel(r_row[col])) << 24) | (uint32_t(to_pixel(g_row[col])) << 16) |
+                       (uint32_t(to_pixel(b_row[col])) << 8) | 255;
+      }
+    }
+  });
+}
+
+template<typename T, typename Guide>
+void guided_filter_views(MatrixView<const T> input_img,
+                         MatrixView<const Guide> guide_img,
+                         size_t radius,
+                         float epsilon,
+                         MatrixView<T> output_img,
+                         BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+  assert(input_img.get_rows() == guide_img.get_rows() && input_img.get_cols() == guide_img.get_cols());
+  if (input_img.empty()) {
+    return;
+  }
+
+  // The input is usually its own guide
+  bool self_guided = std::is_same<T, Guide>::value && input_img.get_stride() == guide_img.get_stride() &&
+                     static_cast<const void*>(input_img.data()) == static_cast<const void*>(guide_img.data());
+
+  BoxMean box_mean(input_img.get_rows(), input_img.get_cols(), radius, border_mode);
+  epsilon = std::max(epsilon, GUIDED_FILTER_MIN_EPSILON);
+  Planes planes = to_planes(input_img);
+  Planes guide = self_guided ? planes : to_planes(guide_img);
+  if (guide.size() == 1) {
+    guide_with_gray(guide[0], planes, self_guided, box_mean, epsilon);
+  } else {
+    guide_with_color(guide, planes, self_guided, box_mean, epsilon);
+  }
+  from_planes(planes, output_img);
+}
+
+template<typename T, typename Guide>
+void guided_filter_images(std::shared_ptr<Matrix<T>> input_img,
+                          std::shared_ptr<Matrix<Guide>> guide_img,
+                          size_t radius,
+                          float epsilon,
+                          std::shared_ptr<Matrix<T>> output_img,
+                          BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<T>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  guided_filter_views<T, Guide>(input_img->view(), guide_img->view(), radius, epsilon, output_img->view(), border_mode);
+}
+}
+
+// GRAY
+void guided_filter(std::shared_ptr<Matrix<uint8_t>> input_img,
+                   std::shared_ptr<Matrix<uint8_t>> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   std::shared_ptr<Matrix<uint8_t>> output_img,
+                   BorderMode border_mode)
+{
+  guided_filter_images(input_img, guide_img, radius, epsilon, output_img, border_mode);
+}
+
+void guided_filter(MatrixView<const uint8_t> input_img,
+                   MatrixView<const uint8_t> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   MatrixView<uint8_t> output_img,
+                   BorderMode border_mode)
+{
+  guided_filter_views(input_img, guide_img, radius, epsilon, output_img, border_mode);
+}
+
+void guided_filter(std::shared_ptr<Matrix<uint8_t>> input_img,
+                   std::shared_ptr<Matrix<uint32_t>> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   std::shared_ptr<Matrix<uint8_t>> output_img,
+                   BorderMode border_mode)
+{
+  guided_filter_images(input_img, guide_img, radius, epsilon, output_img, border_mode);
+}
+
+void guided_filter(MatrixView<const uint8_t> input_img,
+                   MatrixView<const uint32_t> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   MatrixView<uint8_t> output_img,
+                   BorderMode border_mode)
+{
+  guided_filter_views(input_img, guide_img, radius, epsilon, output_img, border_mode);
+}
+
+// RGBA
+void guided_filter(std::shared_ptr<Matrix<uint32_t>> input_img,
+                   std::shared_ptr<Matrix<uint8_t>> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   std::shared_ptr<Matrix<uint32_t>> output_img,
+                   BorderMode border_mode)
+{
+  guided_filter_images(input_img, guide_img, radius, epsilon, output_img, border_mode);
+}
+
+void guided_filter(MatrixView<const uint32_t> input_img,
+                   MatrixView<const uint8_t> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   MatrixView<uint32_t> output_img,
+                   BorderMode border_mode)
+{
+  guided_filter_views(input_img, guide_img, radius, epsilon, output_img, border_mode);
+}
+
+void guided_filter(std::shared_ptr<Matrix<uint32_t>> input_img,
+                   std::shared_ptr<Matrix<uint32_t>> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   std::shared_ptr<Matrix<uint32_t>> output_img,
+                   BorderMode border_mode)
+{
+  guided_filter_images(input_img, guide_img, radius, epsilon, output_img, border_mode);
+}
+
+void guided_filter(MatrixView<const uint32_t> input_img,
+                   MatrixView<const uint32_t> guide_img,
+                   size_t radius,
+                   float epsilon,
+                   MatrixView<uint32_t> output_img,
+                   BorderMode border_mode)
+{
+  guided_filter_views(input_img, guide_img, radius, epsilon, output_img, border_mode);
+}
+}
\ No newline at end of file
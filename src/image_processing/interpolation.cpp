@@ -3,39 +3,44 @@
 #include <cmath>
 #include <cstdio>
 
+#include "utils/parallel.h"
+
 namespace ip {
-uint8_t interpolate_pixel_bilinear(uint8_t nw_pix,
-                                   uint8_t ne_pix,
-                                   uint8_t sw_pix,
-                                   uint8_t se_pix,
-                                   float row_fraction,
-                                   float col_fraction)
+template<typename T>
+T interpolate_pixel_bilinear(T nw_pix, T ne_pix, T sw_pix, T se_pix, float row_fraction, float col_fraction)
 {
   float interpolated_value = (nw_pix * (1.f - row_fraction) * (1.f - col_fraction)) +
                              (ne_pix * row_fraction * (1.f - col_fraction)) +
                              (sw_pix * (1.f - row_fraction) * col_fraction) + (se_pix * row_fraction * col_fraction);
   interpolated_value /= ((1.f - row_fraction) * (1.f - col_fraction) + row_fraction * (1.f - col_fraction) +
                          (1.f - row_fraction) * col_fraction + row_fraction * col_fraction);
-  return uint8_t(interpolated_value);
+  return PixelTraits<T>::saturate(interpolated_value);
+}
+
+template<typename T>
+T interpolate_pixel(std::shared_ptr<Matrix<T>> input_img,
+                    float target_row,
+                    float target_col,
+                    INTERPOLATION_TYPE interp_type)
+{
+  return interpolate_pixel(MatrixView<const T>(input_img->view()), target_row, target_col, interp_type);
 }
 
-uint8_t interpolate_pixel(std::shared_ptr<Matrix<uint8_t>> input_img,
-                          float target_row,
-                          float target_col,
-                          INTERPOLATION_TYPE interp_type)
+template<typename T>
+T interpolate_pixel(MatrixView<const T> input_img, float target_row, float target_col, INTERPOLATION_TYPE interp_type)
 {
   if (interp_type == INTERPOLATION_TYPE::BILINEAR) {
     // Build bilinear neighborhood
     size_t base_row = std::floor(target_row);
     size_t base_col = std::floor(target_col);
 
-    size_t max_row = std::min(input_img->get_rows() - 1, base_row + 1);
-    size_t max_col = std::min(input_img->get_cols() - 1, base_col + 1);
+    size_t max_row = std::min(input_img.get_rows() - 1, base_row + 1);
+    size_t max_col = std::min(input_img.get_cols() - 1, base_col + 1);
 
-    return interpolate_pixel_bilinear(input_img->operator()(base_row, base_col),
-                                      input_img->operator()(base_row, max_col),
-                                      input_img->operator()(max_row, base_col),
-                                      input_img->operator()(max_row, max_col),
+    return interpolate_pixel_bilinear(input_img(base_row, base_col),
+                                      input_img(base_row, max_col),
+                                      input_img(max_row, base_col),
+                                      input_img(max_row, max_col),
                                       target_row - base_row,
                                       target_col - base_col);
   } else {
@@ -43,26 +48,41 @@ uint8_t interpolate_pixel(std::shared_ptr<Matrix<uint8_t>> input_img,
   }
 }
 
-std::shared_ptr<Matrix<uint8_t>> resize(std::shared_ptr<Matrix<uint8_t>> input_img,
-                                        size_t target_rows,
-                                        size_t target_cols,
-                                        INTERPOLATION_TYPE interp_type)
+template<typename T>
+std::shared_ptr<Matrix<T>> resize(std::shared_ptr<Matrix<T>> input_img,
+                                  size_t target_rows,
+                                  size_t target_cols,
+                                  INTERPOLATION_TYPE interp_type)
 {
-  auto output_img = std::make_shared<Matrix<uint8_t>>(target_rows, target_cols);
+  auto output_img = std::make_shared<Matrix<T>>(target_rows, target_cols);
 
   float row_ratio = float(input_img->get_rows()) / float(target_rows);
   float col_ratio = float(input_img->get_cols()) / float(target_cols);
-  for (size_t row = 0; row < target_rows; row++) {
-    for (size_t col = 0; col < target_cols; col++) {
-      float target_row = float(row) * row_ratio;
-      float target_col = float(col) * col_ratio;
-      output_img->operator()(row, col) = interpolate_pixel(input_img, target_row, target_col, interp_type);
+  MatrixView<const T> input_view = input_img->view();
+  utils::parallel_for(target_rows, [&](size_t row_begin, size_t row_end) {
+    for (size_t row = row_begin; row < row_end; row++) {
+      T* output_row = output_img->row_ptr(row);
+      for (size_t col = 0; col < target_cols; col++) {
+        float target_row = float(row) * row_ratio;
+        float target_col = float(col) * col_ratio;
+        output_row[col] = interpolate_pixel(input_view, target_row, target_col, interp_type);
+      }
     }
-  }
+  });
 
   return output_img;
 }
 
+#define INSTANTIATE_INTERPOLATION(T)                                                                                  \
+  template T interpolate_pixel_bilinear<T>(T, T, T, T, float, float);                                                 \
+  template T interpolate_pixel<T>(std::shared_ptr<Matrix<T>>, float, float, INTERPOLATION_TYPE);                      \
+  template T interpolate_pixel<T>(MatrixView<const T>, float, float, INTERPOLATION_TYPE);                             \
+  template std::shared_ptr<Matrix<T>> resize<T>(std::shared_ptr<Matrix<T>>, size_t, size_t, INTERPOLATION_TYPE);
+
+INSTANTIATE_INTERPOLATION(uint8_t)
+INSTANTIATE_INTERPOLATION(uint16_t)
+INSTANTIATE_INTERPOLATION(float)
+
 RGBAPixel interpolate_pixel_bilinear(RGBAPixel nw_pix,
                                      RGBAPixel ne_pix,
                                      RGBAPixel sw_pix,
@@ -79,19 +99,27 @@ uint32_t interpolate_pixel(std::shared_ptr<Matrix<uint32_t>> input_img,
                            float target_row,
                            float target_col,
                            INTERPOLATION_TYPE interp_type)
+{
+  return interpolate_pixel(MatrixView<const uint32_t>(input_img->view()), target_row, target_col, interp_type);
+}
+
+uint32_t interpolate_pixel(MatrixView<const uint32_t> input_img,
+                           float target_row,
+                           float target_col,
+                           INTERPOLATION_TYPE interp_type)
 {
   if (interp_type == INTERPOLATION_TYPE::BILINEAR) {
     // Build bilinear neighborhood
     size_t base_row = std::floor(target_row);
     size_t base_col = std::floor(target_col);
 
-    size_t max_row = std::min(input_img->get_rows() - 1, base_row + 1);
-    size_t max_col = std::min(input_img->get_cols() - 1, base_col + 1);
+    size_t max_row = std::min(input_img.get_rows() - 1, base_row + 1);
+    size_t max_col = std::min(input_img.get_cols() - 1, base_col + 1);
 
-    return interpolate_pixel_bilinear(RGBAPixel(input_img->operator()(base_row, base_col)),
-                                      RGBAPixel(input_img->operator()(base_row, max_col)),
-                                      RGBAPixel(input_img->operator()(max_row, base_col)),
-                                      RGBAPixel(input_img->operator()(max_row, max_col)),
+    return interpolate_pixel_bilinear(RGBAPixel(input_img(base_row, base_col)),
+                                      RGBAPixel(input_img(base_row, max_col)),
+                                      RGBAPixel(input_img(max_row, base_col)),
+                                      RGBAPixel(input_img(max_row, max_col)),
                                       target_row - base_row,
                                       target_col - base_col)
       .to_uint32_t();
@@ -109,13 +137,17 @@ std::shared_ptr<Matrix<uint32_t>> resize(std::shared_ptr<Matrix<uint32_t>> input
 
   float row_ratio = float(input_img->get_rows()) / float(target_rows);
   float col_ratio = float(input_img->get_cols()) / float(target_cols);
-  for (size_t row = 0; row < target_rows; row++) {
-    for (size_t col = 0; col < target_cols; col++) {
-      float target_row = float(row) * row_ratio;
-      float target_col = float(col) * col_ratio;
-      output_img->operator()(row, col) = interpolate_pixel(input_img, target_row, target_col, interp_type);
+  MatrixView<const uint32_t> input_view = input_img->view();
+  utils::parallel_for(target_rows, [&](size_t row_begin, size_t row_end) {
+    for (size_t row = row_begin; row < row_end; row++) {
+      uint32_t* output_row = output_img->row_ptr(row);
+      for (size_t col = 0; col < target_cols; col++) {
+        float target_row = float(row) * row_ratio;
+        float target_col = float(col) * col_ratio;
+        output_row[col] = interpolate_pixel(input_view, target_row, target_col, interp_type);
+      }
     }
-  }
+  });
 
   return output_img;
 }
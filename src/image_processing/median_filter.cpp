@@ -0,0 +1,325 @@
+#include "image_processing/median_filter.h"
+
+#include "utils/parallel.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace ip {
+namespace {
+const size_t COARSE_BINS = 16;
+const size_t FINE_BINS = 256;
+
+// Output columns of a task. Every band also builds the histograms of the kernel_size - 1 columns around it
+const size_t MEDIAN_BAND_SIZE = 256;
+
+// Histograms of the columns of a band, column j covers the rows [row - offset, row - offset + kernel_size)
+struct ColumnHistograms
+{
+  std::vector<uint16_t> coarse; // COARSE_BINS per column
+  std::vector<uint16_t> fine;   // FINE_BINS per column
+
+  explicit ColumnHistograms(size_t n_cols)
+    : coarse(n_cols * COARSE_BINS, 0)
+    , fine(n_cols * FINE_BINS, 0){};
+
+  void add(size_t col, uint8_t value)
+  {
+    ++coarse[col * COARSE_BINS + (value >> 4)];
+    ++fine[col * FINE_BINS + value];
+  };
+  void remove(size_t col, uint8_t value)
+  {
+    --coarse[col * COARSE_BINS + (value >> 4)];
+    --fine[col * FINE_BINS + value];
+  };
+  const uint16_t* coarse_bins(size_t col) const { return coarse.data() + col * COARSE_BINS; };
+  const uint16_t* fine_bins(size_t col, size_t coarse_bin) const
+  {
+    return fine.data() + col * FINE_BINS + coarse_bin * COARSE_BINS;
+  };
+};
+
+// Both levels have 16 bins, the loops below are a couple of vector instructions
+void add_bins(uint16_t* bins, const uint16_t* added)
+{
+  for (size_t bin = 0; bin < COARSE_BINS; ++bin) {
+    bins[bin] = uint16_t(bins[bin] + added[bin]);
+  }
+}
+
+void slide_bins(uint16_t* bins, const uint16_t* added, const uint16_t* removed)
+{
+  for (size_t bin = 0; bin < COARSE_BINS; ++bin) {
+    bins[bin] = uint16_t(bins[bin] + added[bin] - removed[bin]);
+  }
+}
+
+// Median of the rows of a band of columns. get(row, col) reads a pixel of the image, set(row, col, value) writes a
+// median, both with image coordinates
+template<typename Get, typename Set>
+void median_band(size_t rows,
+                 size_t cols,
+                 size_t kernel_size,
+                 BorderMode border_mode,
+                 size_t col_begin,
+                 size_t col_end,
+                 Get get,
+                 Set set)
+{
+  // Same anchor as apply_kernel and box_filter
+  int offset = int((kernel_size - 1) / 2);
+  size_t width = col_end - col_begin;
+  // Source column of every histogram, -1 outside of a CONSTANT border
+  std::vector<int> src_cols(width + kernel_size - 1);
+  for (size_t j = 0; j < src_cols.size(); ++j) {
+    src_cols[j] = border_index(int(col_begin + j) - offset, int(cols), border_mode);
+  }
+  auto read = [&](int src_row, size_t j) {
+    return src_row >= 0 && src_cols[j] >= 0 ? get(size_t(src_row), size_t(src_cols[j])) : uint8_t(0);
+  };
+
+  ColumnHistograms histograms(src_cols.size());
+  for (size_t i = 0; i < kernel_size; ++i) {
+    int src_row = border_index(int(i) - offset, int(rows), border_mode);
+    for (size_t j = 0; j < src_cols.size(); ++j) {
+      histograms.add(j, read(src_row, j));
+    }
+  }
+
+  uint32_t rank = uint32_t(kernel_size * kernel_size - 1) / 2;
+  std::array<uint16_t, COARSE_BINS> coarse;
+  std::array<uint16_t, FINE_BINS> fine;
+  std::array<int, COARSE_BINS> fine_col;
+  for (size_t row = 0; row < rows; ++row) {
+    if (row > 0) {
+      int leaving_row = border_index(int(row) - 1 - offset, int(rows), border_mode);
+      int entering_row = border_index(int(row + kernel_size) - 1 - offset, int(rows), border_mode);
+      for (size_t j = 0; j < src_cols.size(); ++j) {
+        histograms.remove(j, read(leaving_row, j));
+        histograms.add(j, read(entering_row, j));
+      }
+    }
+
+    coarse.fill(0);
+    for (size_t j = 0; j < kernel_size; ++j) {
+      add_bins(coarse.data(), histograms.coarse_bins(j));
+    }
+    // Column of the window the fine bins were last brought up to date for, -1 when never
+    fine_col.fill(-1);
+    for (size_t col = 0; col < width; ++col) {
+      if (col > 0) {
+        slide_bins(coarse.data(), histograms.coarse_bins(col + kernel_size - 1), histograms.coarse_bins(col - 1));
+      }
+
+      uint32_t count = 0;
+      size_t coarse_bin = 0;
+      while (count + coarse[coarse_bin] <= rank) {
+        count += coarse[coarse_bin++];
+      }
+
+      // Slide the fine bins from their last column, or sum them again when that is cheaper
+      uint16_t* fine_bins = fine.data() + coarse_bin * COARSE_BINS;
+      int last_col = fine_col[coarse_bin];
+      if (last_col < 0 || 2 * (col - size_t(last_col)) > kernel_size) {
+        std::fill(fine_bins, fine_bins + COARSE_BINS, 0);
+        for (size_t j = col; j < col + kernel_size; ++j) {
+          add_bins(fine_bins, histograms.fine_bins(j, coarse_bin));
+        }
+      } else {
+        for (size_t j = size_t(last_col) + 1; j <= col; ++j) {
+          slide_bins(fine_bins,
+                     histograms.fine_bins(j + kernel_size - 1, coarse_bin),
+                     histograms.fine_bins(j - 1, coarse_bin));
+        }
+      }
+      fine_col[coarse_bin] = int(col);
+
+      size_t fine_bin = 0;
+      while (count + fine_bins[fine_bin] <= rank) {
+        count += fine_bins[fine_bin++];
+      }
+      set(row, col_begin + col, uint8_t(coarse_bin * COARSE_BINS + fine_bin));
+    }
+  }
+}
+
+// 3x3 windows, the common denoising case, skip the histograms: the median of 9 values is the median of the largest
+// column minimum, the median column median and the smallest column maximum. Rows of medians only take min and max
+// along contiguous lines, which vectorize. Lines hold one pixel of border on each side, lows, mids and highs are
+// scratch lines of the same size
+void median_3x3_row(const uint8_t* above,
+                    const uint8_t* center,
+                    const uint8_t* below,
+                    size_t cols,
+                    uint8_t* lows,
+                    uint8_t* mids,
+                    uint8_t* highs,
+                    uint8_t* medians)
+{
+  // One output per loop, which keeps the aliasing checks of the vectorizer low
+  for (size_t i = 0; i < cols + 2; ++i) {
+    lows[i] = std::min(std::min(above[i], center[i]), below[i]);
+  }
+  for (size_t i = 0; i < cols + 2; ++i) {
+    highs[i] = std::max(std::max(above[i], center[i]), below[i]);
+  }
+  for (size_t i = 0; i < cols + 2; ++i) {
+    uint8_t low = std::min(above[i], center[i]), high = std::max(above[i], center[i]);
+    mids[i] = std::max(low, std::min(high, below[i]));
+  }
+  for (size_t col = 0; col < cols; ++col) {
+    uint8_t max_low = std::max(std::max(lows[col], lows[col + 1]), lows[col + 2]);
+    uint8_t min_high = std::min(std::min(highs[col], highs[col + 1]), highs[col + 2]);
+    uint8_t mid_low = std::min(mids[col], mids[col + 1]), mid_high = std::max(mids[col], mids[col + 1]);
+    uint8_t median_mid = std::max(mid_low, std::min(mid_high, mids[col + 2]));
+    uint8_t low = std::min(max_low, min_high), high = std::max(max_low, min_high);
+    medians[col] = std::max(low, std::min(high, median_mid));
+  }
+}
+
+template<typename Get, typename Set>
+void median_3x3(size_t rows, size_t cols, BorderMode border_mode, Get get, Set set)
+{
+  int first_col = border_index(-1, int(cols), border_mode);
+  int last_col = border_index(int(cols), int(cols), border_mode);
+  auto read_line = [&](int row, uint8_t* line) {
+    int src_row = border_index(row, int(rows), border_mode);
+    if (src_row < 0) {
+      std::fill(line, line + cols + 2, uint8_t(0));
+      return;
+    }
+    for (size_t col = 0; col < cols; ++col) {
+      line[col + 1] = get(size_t(src_row), col);
+    }
+    line[0] = first_col >= 0 ? get(size_t(src_row), size_t(first_col)) : uint8_t(0);
+    line[cols + 1] = last_col >= 0 ? get(size_t(src_row), size_t(last_col)) : uint8_t(0);
+  };
+
+  utils::parallel_for(rows, [&](size_t row_begin, size_t row_end) {
+    // Lines of the rows row - 1, row and row + 1, rotated from a row to the next one
+    std::array<std::vector<uint8_t>, 3> lines;
+    for (std::vector<uint8_t>& line : lines) {
+      line.resize(cols + 2);
+    }
+    std::vector<uint8_t> lows(cols + 2), mids(cols + 2), highs(cols + 2), medians(cols);
+    read_line(int(row_begin) - 1, lines[0].data());
+    read_line(int(row_begin), lines[1].data());
+    for (size_t row = row_begin; row < row_end; ++row) {
+      read_line(int(row) + 1, lines[2].data());
+      median_3x3_row(lines[0].data(),
+                     lines[1].data(),
+                     lines[2].data(),
+                     cols,
+                     lows.data(),
+                     mids.data(),
+                     highs.data(),
+                     medians.data());
+      for (size_t col = 0; col < cols; ++col) {
+        set(row, col, medians[col]);
+      }
+      std::rotate(lines.begin(), lines.begin() + 1, lines.end());
+    }
+  });
+}
+
+template<typename Get, typename Set>
+void median(size_t rows, size_t cols, size_t kernel_size, BorderMode border_mode, Get get, Set set)
+{
+  kernel_size = std::min(kernel_size, MEDIAN_MAX_KERNEL_SIZE);
+  if (kernel_size == 3) {
+    median_3x3(rows, cols, border_mode, get, set);
+    return;
+  }
+
+  size_t n_bands = (cols + MEDIAN_BAND_SIZE - 1) / MEDIAN_BAND_SIZE;
+  utils::parallel_for(
+    n_bands,
+    [&](size_t band_begin, size_t band_end) {
+      for (size_t band_index = band_begin; band_index < band_end; ++band_index) {
+        size_t col_begin = band_index * MEDIAN_BAND_SIZE;
+        size_t col_end = std::min(col_begin + MEDIAN_BAND_SIZE, cols);
+        median_band(rows, cols, kernel_size, border_mode, col_begin, col_end, get, set);
+      }
+    },
+    1);
+}
+}
+
+void median_filter(std::shared_ptr<Matrix<uint8_t>> input_img,
+                   size_t kernel_size,
+                   std::shared_ptr<Matrix<uint8_t>> output_img,
+                   BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<uint8_t>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  median_filter(input_img->view(), kernel_size, output_img->view(), border_mode);
+}
+
+void median_filter(MatrixView<const uint8_t> input_img,
+                   size_t kernel_size,
+                   MatrixView<uint8_t> output_img,
+                   BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+  if (input_img.empty() || kernel_size == 0) {
+    return;
+  }
+
+  auto get = [&input_img](size_t row, size_t col) { return input_img(row, col); };
+  auto set = [&output_img](size_t row, size_t col, uint8_t value) { output_img(row, col) = value; };
+  median(input_img.get_rows(), input_img.get_cols(), kernel_size, border_mode, get, set);
+}
+
+// RGBA
+void median_filter(std::shared_ptr<Matrix<uint32_t>> input_img,
+                   size_t kernel_size,
+                   std::shared_ptr<Matrix<uint32_t>> output_img,
+                   BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<uint32_t>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  median_filter(input_img->view(), kernel_size, output_img->view(), border_mode);
+}
+
+void median_filter(MatrixView<const uint32_t> input_img,
+                   size_t kernel_size,
+                   MatrixView<uint32_t> output_img,
+                   BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+  if (input_img.empty() || kernel_size == 0) {
+    return;
+  }
+
+  // Channels are filtered one after the other, each of them ORed into the output
+  for (uint32_t shift : { 24u, 16u, 8u }) {
+    auto get = [&input_img, shift](size_t row, size_t col) { return uint8_t(input_img(row, col) >> shift); };
+    auto set = [&output_img, shift](size_t row, size_t col, uint8_t value) {
+      uint32_t channel = uint32_t(value) << shift;
+      output_img(row, col) = shift == 24u ? (channel | 255) : (output_img(row, col) | channel);
+    };
+    median(input_img.get_rows(), input_img.get_cols(), kernel_size, border_mode, get, set);
+  }
+}
+
+// PLANAR
+void median_filter(std::shared_ptr<PlanarImage> input_img,
+                   size_t kernel_size,
+                   std::shared_ptr<PlanarImage> output_img,
+                   BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = PlanarImage(input_img->get_rows(), input_img->get_cols());
+  }
+
+  for (size_t channel : { PlanarImage::R, PlanarImage::G, PlanarImage::B }) {
+    median_filter(input_img->plane(channel).view(), kernel_size, output_img->plane(channel).view(), border_mode);
+  }
+  output_img->fill_alpha();
+}
+}
\ No newline at end of file
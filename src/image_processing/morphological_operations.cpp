@@ -6,33 +6,26 @@
 #include "image_processing/utils.h"
 
 namespace ip {
+// The h gradients work along columns. They run as a row pass over the transposed image, so that every window is
+// contiguous in memory instead of striding over one row per tap
 std::shared_ptr<Matrix<uint8_t>> apply_h_gradient(std::shared_ptr<Matrix<uint8_t>> input_img, size_t gradient_size)
 {
-  auto output_img = std::make_shared<Matrix<uint8_t>>(input_img->get_rows(), input_img->get_cols());
-  for (size_t row = 0; row < input_img->get_rows() - gradient_size + 1; ++row) {
-    for (size_t col = 0; col < input_img->get_cols(); ++col) {
-      std::vector<size_t> buffer(gradient_size);
-      for (size_t delta = 0; delta < gradient_size; ++delta) {
-        buffer.push_back(input_img->operator()(row + delta, col));
-      }
-      auto min_max = std::minmax_element(buffer.begin(), buffer.end());
-      output_img->operator()(row, col) = *min_max.second - *min_max.first;
-    }
-  }
+  auto transposed_img = std::make_shared<Matrix<uint8_t>>(input_img->transpose());
+  auto output_img = apply_v_gradient(transposed_img, gradient_size);
+  output_img->transpose_in_place();
   return output_img;
 }
 
 std::shared_ptr<Matrix<uint8_t>> apply_v_gradient(std::shared_ptr<Matrix<uint8_t>> input_img, size_t gradient_size)
 {
   auto output_img = std::make_shared<Matrix<uint8_t>>(input_img->get_rows(), input_img->get_cols());
+  output_img->fill(0);
   for (size_t row = 0; row < input_img->get_rows(); ++row) {
-    for (size_t col = 0; col < input_img->get_cols() - gradient_size + 1; ++col) {
-      std::vector<size_t> buffer(gradient_size);
-      for (size_t delta = 0; delta < gradient_size; ++delta) {
-        buffer.push_back(input_img->operator()(row, col + delta));
-      }
-      auto min_max = std::minmax_element(buffer.begin(), buffer.end());
-      output_img->operator()(row, col) = *min_max.second - *min_max.first;
+    const uint8_t* input_row = input_img->row_ptr(row);
+    uint8_t* output_row = output_img->row_ptr(row);
+    for (size_t col = 0; col + gradient_size <= input_img->get_cols(); ++col) {
+      auto min_max = std::minmax_element(input_row + col, input_row + col + gradient_size);
+      output_row[col] = *min_max.second - *min_max.first;
     }
   }
   return output_img;
@@ -40,36 +33,23 @@ std::shared_ptr<Matrix<uint8_t>> apply_v_gradient(std::shared_ptr<Matrix<uint8_t
 
 std::shared_ptr<Matrix<uint32_t>> apply_h_gradient(std::shared_ptr<Matrix<uint32_t>> input_img, size_t gradient_size)
 {
-  auto output_img = std::make_shared<Matrix<uint32_t>>(input_img->get_rows(), input_img->get_cols());
-  std::vector<size_t> buffer_r(gradient_size), buffer_b(gradient_size), buffer_g(gradient_size);
-  for (size_t row = 0; row < input_img->get_rows() - gradient_size + 1; ++row) {
-    for (size_t col = 0; col < input_img->get_cols(); ++col) {
-      for (size_t delta = 0; delta < gradient_size; ++delta) {
-        RGBAPixel pix(input_img->operator()(row + delta, col));
-        buffer_r[delta] = pix.r;
-        buffer_g[delta] = pix.g;
-        buffer_b[delta] = pix.b;
-      }
-      auto min_max_r = std::minmax_element(buffer_r.begin(), buffer_r.end());
-      auto min_max_g = std::minmax_element(buffer_g.begin(), buffer_g.end());
-      auto min_max_b = std::minmax_element(buffer_b.begin(), buffer_b.end());
-      output_img->operator()(row, col) = RGBAPixel(*min_max_r.second - *min_max_r.first,
-                                                   *min_max_g.second - *min_max_g.first,
-                                                   *min_max_b.second - *min_max_b.first)
-                                           .to_uint32_t();
-    }
-  }
+  auto transposed_img = std::make_shared<Matrix<uint32_t>>(input_img->transpose());
+  auto output_img = apply_v_gradient(transposed_img, gradient_size);
+  output_img->transpose_in_place();
   return output_img;
 }
 
 std::shared_ptr<Matrix<uint32_t>> apply_v_gradient(std::shared_ptr<Matrix<uint32_t>> input_img, size_t gradient_size)
 {
   auto output_img = std::make_shared<Matrix<uint32_t>>(input_img->get_rows(), input_img->get_cols());
+  output_img->fill(0);
   std::vector<size_t> buffer_r(gradient_size), buffer_b(gradient_size), buffer_g(gradient_size);
   for (size_t row = 0; row < input_img->get_rows(); ++row) {
-    for (size_t col = 0; col < input_img->get_cols() - gradient_size + 1; ++col) {
+    const uint32_t* input_row = input_img->row_ptr(row);
+    uint32_t* output_row = output_img->row_ptr(row);
+    for (size_t col = 0; col + gradient_size <= input_img->get_cols(); ++col) {
       for (size_t delta = 0; delta < gradient_size; ++delta) {
-        RGBAPixel pix(input_img->operator()(row, col + delta));
+        RGBAPixel pix(input_row[col + delta]);
         buffer_r[delta] = pix.r;
         buffer_g[delta] = pix.g;
         buffer_b[delta] = pix.b;
@@ -77,10 +57,10 @@ std::shared_ptr<Matrix<uint32_t>> apply_v_gradient(std::shared_ptr<Matrix<uint32
       auto min_max_r = std::minmax_element(buffer_r.begin(), buffer_r.end());
       auto min_max_g = std::minmax_element(buffer_g.begin(), buffer_g.end());
       auto min_max_b = std::minmax_element(buffer_b.begin(), buffer_b.end());
-      output_img->operator()(row, col) = RGBAPixel(*min_max_r.second - *min_max_r.first,
-                                                   *min_max_g.second - *min_max_g.first,
-                                                   *min_max_b.second - *min_max_b.first)
-                                           .to_uint32_t();
+      output_row[col] = RGBAPixel(*min_max_r.second - *min_max_r.first,
+                                  *min_max_g.second - *min_max_g.first,
+                                  *min_max_b.second - *min_max_b.first)
+                          .to_uint32_t();
     }
   }
   return output_img;
@@ -1,81 +1,76 @@
 #include "image_processing/normalization.h"
 
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include "utils/parallel.h"
+
 namespace ip {
 uint8_t normalize_value(uint8_t value, float min, float max)
 {
   return uint8_t((value - min) * (255.f / (max - min)));
 }
 
-std::vector<uint8_t> find_min_max(std::shared_ptr<Matrix<uint8_t>> input_img)
+namespace {
+// (min, max) pairs, merged by the parallel reductions
+template<typename T>
+using MinMax = std::array<T, 2>;
+
+template<typename T>
+MinMax<T> find_min_max(MatrixView<const T> plane)
 {
-  uint8_t min = 255;
-  uint8_t max = 0;
-  for (size_t row = 0; row < input_img->get_rows(); ++row) {
-    for (size_t col = 0; col < input_img->get_cols(); ++col) {
-      uint8_t value = input_img->operator()(row, col);
-      if (value > max) {
-        max = value;
-      }
-      if (value < min) {
-        min = value;
-      }
-    }
-  }
-  std::vector<uint8_t> min_max{ min, max };
-  return min_max;
+  auto merge = [](const MinMax<T>& lhs, const MinMax<T>& rhs) {
+    return MinMax<T>{ std::min(lhs[0], rhs[0]), std::max(lhs[1], rhs[1]) };
+  };
+  MinMax<T> init{ std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest() };
+  return utils::transform_reduce(plane, init, merge, [](T value) { return MinMax<T>{ value, value }; });
+}
 }
 
-std::shared_ptr<Matrix<uint8_t>> min_max_normalization(std::shared_ptr<Matrix<uint8_t>> input_img)
+template<typename T>
+std::vector<T> find_min_max(std::shared_ptr<Matrix<T>> input_img)
 {
-  std::vector<uint8_t> min_max = find_min_max(input_img);
+  MinMax<T> min_max = find_min_max(MatrixView<const T>(input_img->view()));
+  return std::vector<T>{ min_max[0], min_max[1] };
+}
+
+template<typename T>
+std::shared_ptr<Matrix<T>> min_max_normalization(std::shared_ptr<Matrix<T>> input_img)
+{
+  std::vector<T> min_max = find_min_max(input_img);
   float min = float(min_max[0]);
   float max = float(min_max[1]);
-  std::shared_ptr<Matrix<uint8_t>> res_img =
-    std::make_shared<Matrix<uint8_t>>(input_img->get_rows(), input_img->get_cols());
-  for (size_t row = 0; row < input_img->get_rows(); ++row) {
-    for (size_t col = 0; col < input_img->get_cols(); ++col) {
-      res_img->operator()(row, col) = normalize_value(input_img->operator()(row, col), min, max);
-    }
-  }
-  return res_img;
+  // Same arithmetic as normalize_value, fused in a single pass
+  return std::make_shared<Matrix<T>>((*input_img - min) * (PixelTraits<T>::max_value / (max - min)),
+                                     ExecutionMode::PARALLEL);
 }
 
+template std::vector<uint8_t> find_min_max<uint8_t>(std::shared_ptr<Matrix<uint8_t>>);
+template std::vector<uint16_t> find_min_max<uint16_t>(std::shared_ptr<Matrix<uint16_t>>);
+template std::vector<float> find_min_max<float>(std::shared_ptr<Matrix<float>>);
+template std::shared_ptr<Matrix<uint8_t>> min_max_normalization<uint8_t>(std::shared_ptr<Matrix<uint8_t>>);
+template std::shared_ptr<Matrix<uint16_t>> min_max_normalization<uint16_t>(std::shared_ptr<Matrix<uint16_t>>);
+template std::shared_ptr<Matrix<float>> min_max_normalization<float>(std::shared_ptr<Matrix<float>>);
+
 // RGBA
 std::vector<uint8_t> find_min_max(std::shared_ptr<Matrix<uint32_t>> input_img)
 {
-  uint8_t r_min = 255, g_min = 255, b_min = 255;
-  uint8_t r_max = 0, g_max = 0, b_max = 0;
-  ;
-  for (size_t row = 0; row < input_img->get_rows(); ++row) {
-    for (size_t col = 0; col < input_img->get_cols(); ++col) {
-      uint32_t rgba_pixel = input_img->operator()(row, col);
-
-      uint8_t _r = (rgba_pixel & 0xff000000) >> 24;
-      uint8_t _g = (rgba_pixel & 0x00ff0000) >> 16;
-      uint8_t _b = (rgba_pixel & 0x0000ff00) >> 8;
-
-      if (_r > r_max) {
-        r_max = _r;
-      }
-      if (_r < r_min) {
-        r_min = _r;
-      }
-      if (_g > g_max) {
-        g_max = _g;
-      }
-      if (_g < g_min) {
-        g_min = _g;
-      }
-      if (_b > b_max) {
-        b_max = _b;
-      }
-      if (_b < b_min) {
-        b_min = _b;
-      }
-    }
-  }
-  std::vector<uint8_t> min_max{ r_min, r_max, g_min, g_max, b_min, b_max };
-  return min_max;
+  // r_min, r_max, g_min, g_max, b_min, b_max
+  using ChannelsMinMax = std::array<uint8_t, 6>;
+  auto merge = [](const ChannelsMinMax& lhs, const ChannelsMinMax& rhs) {
+    return ChannelsMinMax{ std::min(lhs[0], rhs[0]), std::max(lhs[1], rhs[1]), std::min(lhs[2], rhs[2]),
+                           std::max(lhs[3], rhs[3]), std::min(lhs[4], rhs[4]), std::max(lhs[5], rhs[5]) };
+  };
+  auto unpack = [](uint32_t rgba_pixel) {
+    uint8_t _r = (rgba_pixel & 0xff000000) >> 24;
+    uint8_t _g = (rgba_pixel & 0x00ff0000) >> 16;
+    uint8_t _b = (rgba_pixel & 0x0000ff00) >> 8;
+    return ChannelsMinMax{ _r, _r, _g, _g, _b, _b };
+  };
+  ChannelsMinMax min_max =
+    utils::transform_reduce(input_img->view(), ChannelsMinMax{ 255, 0, 255, 0, 255, 0 }, merge, unpack);
+  return std::vector<uint8_t>(min_max.begin(), min_max.end());
 }
 
 std::shared_ptr<Matrix<uint32_t>> min_max_normalization(std::shared_ptr<Matrix<uint32_t>> input_img)
@@ -85,17 +80,31 @@ std::shared_ptr<Matrix<uint32_t>> min_max_normalization(std::shared_ptr<Matrix<u
   float r_max = float(min_max[1]), g_max = float(min_max[3]), b_max = float(min_max[5]);
   std::shared_ptr<Matrix<uint32_t>> res_img =
     std::make_shared<Matrix<uint32_t>>(input_img->get_rows(), input_img->get_cols());
-  for (size_t row = 0; row < input_img->get_rows(); ++row) {
-    for (size_t col = 0; col < input_img->get_cols(); ++col) {
-      uint32_t rgba_pixel = input_img->operator()(row, col);
+  utils::transform(input_img->view(), res_img->view(), [=](uint32_t rgba_pixel) {
+    uint8_t _r = normalize_value((rgba_pixel & 0xff000000) >> 24, r_min, r_max);
+    uint8_t _g = normalize_value((rgba_pixel & 0x00ff0000) >> 16, g_min, g_max);
+    uint8_t _b = normalize_value((rgba_pixel & 0x0000ff00) >> 8, b_min, b_max);
+
+    return uint32_t(_r << 24 | _g << 16 | _b << 8 | 255);
+  });
+  return res_img;
+}
+
+// PLANAR
+std::shared_ptr<PlanarImage> min_max_normalization(std::shared_ptr<PlanarImage> input_img)
+{
+  auto res_img = std::make_shared<PlanarImage>(input_img->get_rows(), input_img->get_cols());
+  for (size_t channel : { PlanarImage::R, PlanarImage::G, PlanarImage::B }) {
+    const Matrix<uint8_t>& plane = input_img->plane(channel);
+    Matrix<uint8_t>& res_plane = res_img->plane(channel);
 
-      uint8_t _r = normalize_value((rgba_pixel & 0xff000000) >> 24, r_min, r_max);
-      uint8_t _g = normalize_value((rgba_pixel & 0x00ff0000) >> 16, g_min, g_max);
-      uint8_t _b = normalize_value((rgba_pixel & 0x0000ff00) >> 8, b_min, b_max);
+    MinMax<uint8_t> min_max = find_min_max(plane.view());
 
-      res_img->operator()(row, col) = uint32_t(_r << 24 | _g << 16 | _b << 8 | 255);
-    }
+    float f_min = float(min_max[0]);
+    float scale = 255.f / (float(min_max[1]) - f_min);
+    evaluate((plane - f_min) * scale, res_plane.view(), ExecutionMode::PARALLEL);
   }
+  res_img->fill_alpha();
   return res_img;
 }
 }
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "image_processing/recursive_gaussian.h"
+
+#include "utils/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+namespace ip {
+namespace {
+// Padding of the lines, in sigmas
+const float IIR_GAUSSIAN_MARGIN = 4.f;
+
+// Coefficients of the recursion y[n] = B x[n] + b1 y[n-1] + b2 y[n-2] + b3 y[n-3] (already divided by b0). The poles
+// get close to 1 for large sigmas, so the recursion runs in double: B is then tiny and float rounding errors in the
+// state are amplified by about 1 / B, a flat image of 200 drifted by more than a gray level at sigma 60
+struct RecursiveGaussianCoefficients
+{
+  double b1, b2, b3, B;
+
+  explicit RecursiveGaussianCoefficients(float sigma)
+  {
+    double s = std::max(sigma, 0.5f);
+    double q = s >= 2.5 ? 0.98711 * s - 0.96330 : 3.97156 - 4.14554 * std::sqrt(1. - 0.26891 * s);
+    double q2 = q * q;
+    double q3 = q2 * q;
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    b1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+    b2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+    b3 = 0.422205 * q3 / b0;
+    // Unit gain in the arithmetic of the recursion
+    B = 1. - (b1 + b2 + b3);
+  };
+};
+
+// Blurred values are rounded to the nearest level of integer formats, truncating would darken flat regions
+template<typename T>
+T to_pixel(float value)
+{
+  return PixelTraits<T>::saturate(std::is_integral<T>::value ? value + 0.5f : value);
+}
+
+// Causal then anticausal pass over a line, in place. Both start from the steady state of their first sample, the
+// padding makes this initialization irrelevant
+void filter_line(float* line, size_t size, const RecursiveGaussianCoefficients& c)
+{
+  double w1 = line[0], w2 = line[0], w3 = line[0];
+  for (size_t i = 0; i < size; ++i) {
+    double w = c.B * line[i] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+    line[i] = float(w);
+    w3 = w2;
+    w2 = w1;
+    w1 = w;
+  }
+  w1 = w2 = w3 = line[size - 1];
+  for (size_t i = size; i-- > 0;) {
+    double w = c.B * line[i] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+    line[i] = float(w);
+    w3 = w2;
+    w2 = w1;
+    w1 = w;
+  }
+}
+
+// Blurs a plane into a float image. get(row, col) reads the input plane
+template<typename Get>
+void recursive_gaussian_plane(size_t rows,
+                              size_t cols,
+                              float sigma,
+                              BorderMode border_mode,
+                              Get get,
+                              MatrixView<float> output_img)
+{
+  RecursiveGaussianCoefficients c(sigma);
+  size_t margin = size_t(std::ceil(IIR_GAUSSIAN_MARGIN * sigma));
+
+  // Rows, each of them padded on both sides
+  utils::parallel_for(rows, [&](size_t row_begin, size_t row_end) {
+    std::vector<float> line(cols + 2 * margin);
+    for (size_t row = row_begin; row < row_end; ++row) {
+      for (size_t i = 0; i < line.size(); ++i) {
+        int col = border_index(int(i) - int(margin), cols, border_mode);
+        line[i] = col >= 0 ? get(row, col) : 0.f;
+      }
+      filter_line(line.data(), line.size(), c);
+      std::copy(line.begin() + margin, line.begin() + margin + cols, output_img.row_ptr(row));
+    }
+  });
+
+  // Columns, filtered by bands of adjacent columns so that every step reads contiguous memory. The causal pass keeps
+  // the whole padded band, the anticausal one writes the output rows
+  const size_t band_size = utils::PARALLEL_GRAIN_ROWS;
+  size_t n_bands = (cols + band_size - 1) / band_size;
+  size_t padded_rows = rows + 2 * margin;
+  utils::parallel_for(
+    n_bands,
+    [&](size_t band_begin, size_t band_end) {
+      std::vector<float> band(padded_rows * band_size);
+      std::vector<double> state(3 * band_size);
+      for (size_t band_index = band_begin; band_index < band_end; ++band_index) {
+        size_t col_begin = band_index * band_size;
+        size_t width = std::min(band_size, cols - col_begin);
+        double *w1 = state.data(), *w2 = w1 + band_size, *w3 = w2 + band_size;
+
+        for (size_t i = 0; i < padded_rows; ++i) {
+          int row = border_index(int(i) - int(margin), rows, border_mode);
+          float* band_row = band.data() + i * band_size;
+          if (row >= 0) {
+            std::copy(output_img.row_ptr(row) + col_begin, output_img.row_ptr(row) + col_begin + width, band_row);
+          } else {
+            std::fill(band_row, band_row + width, 0.f);
+          }
+        }
+
+        std::copy(band.begin(), band.begin() + width, w1);
+        std::copy(w1, w1 + width, w2);
+        std::copy(w1, w1 + width, w3);
+        for (size_t i = 0; i < padded_rows; ++i) {
+          float* band_row = band.data() + i * band_size;
+          for (size_t col = 0; col < width; ++col) {
+            double w = c.B * band_row[col] + c.b1 * w1[col] + c.b2 * w2[col] + c.b3 * w3[col];
+            band_row[col] = float(w);
+            w3[col] = w2[col];
+            w2[col] = w1[col];
+            w1[col] = w;
+          }
+        }
+
+        const float* last_row = band.data() + (padded_rows - 1) * band_size;
+        std::copy(last_row, last_row + width, w1);
+        std::copy(last_row, last_row + width, w2);
+        std::copy(last_row, last_row + width, w3);
+        for (size_t i = padded_rows; i-- > 0;) {
+          float* band_row = band.data() + i * band_size;
+          for (size_t col = 0; col < width; ++col) {
+            double w = c.B * band_row[col] + c.b1 * w1[col] + c.b2 * w2[col] + c.b3 * w3[col];
+            band_row[col] = float(w);
+            w3[col] = w2[col];
+            w2[col] = w1[col];
+            w1[col] = w;
+          }
+          if (i >= margin && i < margin + rows) {
+            std::copy(band_row, band_row + width, output_img.row_ptr(i - margin) + col_begin);
+          }
+        }
+      }
+    },
+    1);
+}
+}
+
+template<typename T>
+void recursive_gaussian_blur(std::shared_ptr<Matrix<T>> input_img,
+                             float sigma,
+                             std::shared_ptr<Matrix<T>> output_img,
+                             BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<T>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  recursive_gaussian_blur<T>(input_img->view(), sigma, output_img->view(), border_mode);
+}
+
+template<typename T>
+void recursive_gaussian_blur(MatrixView<const T> input_img,
+                             float sigma,
+                             MatrixView<T> output_img,
+                             BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+  if (input_img.empty()) {
+    return;
+  }
+
+  Matrix<float> blurred_img(input_img.get_rows(), input_img.get_cols());
+  auto get = [&input_img](size_t row, size_t col) { return float(input_img(row, col)); };
+  recursive_gaussian_plane(input_img.get_rows(), input_img.get_cols(), sigma, border_mode, get, blurred_img.view());
+  utils::transform(MatrixView<const float>(blurred_img.view()), output_img, to_pixel<T>);
+}
+
+template void recursive_gaussian_blur<uint8_t>(std::shared_ptr<Matrix<uint8_t>>,
+                                               float,
+                                               std::shared_ptr<Matrix<uint8_t>>,
+                                               BorderMode);
+template void recursive_gaussian_blur<uint16_t>(std::shared_ptr<Matrix<uint16_t>>,
+                                                float,
+                                                std::shared_ptr<Matrix<uint16_t>>,
+                                                BorderMode);
+template void recursive_gaussian_blur<float>(std::shared_ptr<Matrix<float>>,
+                                             float,
+                                             std::shared_ptr<Matrix<float>>,
+                                             BorderMode);
+template void recursive_gaussian_blur<uint8_t>(MatrixView<const uint8_t>, float, MatrixView<uint8_t>, BorderMode);
+template void recursive_gaussian_blur<uint16_t>(MatrixView<const uint16_t>, float, MatrixView<uint16_t>, BorderMode);
+template void recursive_gaussian_blur<float>(MatrixView<const float>, float, MatrixView<float>, BorderMode);
+
+// RGBA
+void recursive_gaussian_blur(std::shared_ptr<Matrix<uint32_t>> input_img,
+                             float sigma,
+                             std::shared_ptr<Matrix<uint32_t>> output_img,
+                             BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<uint32_t>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  recursive_gaussian_blur(input_img->view(), sigma, output_img->view(), border_mode);
+}
+
+void recursive_gaussian_blur(MatrixView<const uint32_t> input_img,
+                             float sigma,
+                             MatrixView<uint32_t> output_img,
+                             BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+  if (input_img.empty()) {
+    return;
+  }
+
+  // Channels are blurred one after the other, each of them ORed into the output
+  Matrix<float> blurred_img(input_img.get_rows(), input_img.get_cols());
+  for (uint32_t shift : { 24u, 16u, 8u }) {
+    auto get = [&input_img, shift](size_t row, size_t col) { return float((input_img(row, col) >> shift) & 0xff); };
+    recursive_gaussian_plane(input_img.get_rows(), input_img.get_cols(), sigma, border_mode, get, blurred_img.view());
+    utils::parallel_for(input_img.get_rows(), [&](size_t row_begin, size_t row_end) {
+      for (size_t row = row_begin; row < row_end; ++row) {
+        RowSpan<const float> blurred_row = blurred_img.row(row);
+        RowSpan<uint32_t> output_row = output_img.row(row);
+        for (size_t col = 0; col < output_row.size(); ++col) {
+          uint32_t value = uint32_t(to_pixel<uint8_t>(blurred_row[col])) << shift;
+          output_row[col] = shift == 24u ? (value | 255) : (output_row[col] | value);
+        }
+      }
+    });
+  }
+}
+
+// PLANAR
+void recursive_gaussian_blur(std::shared_ptr<PlanarImage> input_img,
+                             float sigma,
+                             std::shared_ptr<PlanarImage> output_img,
+                             BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = PlanarImage(input_img->get_rows(), input_img->get_cols());
+  }
+
+  for (size_t channel : { PlanarImage::R, PlanarImage::G, PlanarImage::B }) {
+    recursive_gaussian_blur<uint8_t>(
+      input_img->plane(channel).view(), sigma, output_img->plane(channel).view(), border_mode);
+  }
+  output_img->fill_alpha();
+}
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "image_processing/segmentation/similitude.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -21,6 +22,7 @@ RegionSimilitude::RegionSimilitude(float similitude_threshold,
 {
   hsva_img = ip::rgba_to_hsva(rgba_img);
   res_img = std::make_shared<Matrix<uint32_t>>(rgba_img->get_rows(), rgba_img->get_cols());
+  res_img->fill(0);
 }
 
 std::shared_ptr<Matrix<uint32_t>> RegionSimilitude::process()
@@ -169,10 +171,16 @@ void RegionSimilitude::create_regions()
 void RegionSimilitude::check_homogenous_region_hsva(HSVARegion& region)
 {
   region.already_processed = true;
+  auto region_view = hsva_img->view(region.row_min, region.col_min, region.row_max - region.row_min,
+                                    region.col_max - region.col_min);
   std::vector<uint8_t> hue_vect, sat_vect, val_vect;
-  for (size_t row = region.row_min; row < region.row_max; ++row) {
-    for (size_t col = region.col_min; col < region.col_max; ++col) {
-      HSVAPixel pix(hsva_img->operator()(row, col));
+  hue_vect.reserve(region_view.get_rows() * region_view.get_cols());
+  sat_vect.reserve(region_view.get_rows() * region_view.get_cols());
+  val_vect.reserve(region_view.get_rows() * region_view.get_cols());
+  for (size_t row = 0; row < region_view.get_rows(); ++row) {
+    const uint32_t* region_row = region_view.row_ptr(row);
+    for (size_t col = 0; col < region_view.get_cols(); ++col) {
+      HSVAPixel pix(region_row[col]);
       hue_vect.push_back(pix.h);
       sat_vect.push_back(pix.s);
       val_vect.push_back(pix.v);
@@ -190,18 +198,16 @@ void RegionSimilitude::check_homogenous_region_hsva(HSVARegion& region)
   float h_mean = compute_hue_mean(hue_vect);
   region.pix = HSVAPixel(uint8_t(h_mean), uint8_t(s_mean), uint8_t(v_mean));
 
-  for (size_t row = region.row_min; row < region.row_max; ++row) {
-    for (size_t col = region.col_min; col < region.col_max; ++col) {
-      HSVAPixel pix(hsva_img->operator()(row, col));
-      float h_dist = std::abs(float(pix.h) - h_mean);
-      h_dist = std::min(h_dist, 255.f - h_dist) / 255.f;
-      float dist =
-        (1.f / 3.f) *
-        std::sqrt(std::pow(h_dist + std::abs(float(pix.s) - s_mean) / 255.f + std::abs(pix.v - v_mean) / 255.f, 2.f));
-      if (dist > similitude_threshold) {
-        region.is_homogenous = false;
-        return;
-      }
+  // Pixels were already unpacked above, no need to go through the image again
+  for (size_t idx = 0; idx < hue_vect.size(); ++idx) {
+    float h_dist = std::abs(float(hue_vect[idx]) - h_mean);
+    h_dist = std::min(h_dist, 255.f - h_dist) / 255.f;
+    float dist = (1.f / 3.f) * std::sqrt(std::pow(h_dist + std::abs(float(sat_vect[idx]) - s_mean) / 255.f +
+                                                    std::abs(val_vect[idx] - v_mean) / 255.f,
+                                                  2.f));
+    if (dist > similitude_threshold) {
+      region.is_homogenous = false;
+      return;
     }
   }
   region.is_homogenous = true;
@@ -209,10 +215,11 @@ void RegionSimilitude::check_homogenous_region_hsva(HSVARegion& region)
 
 void RegionSimilitude::paint_region(HSVARegion& region)
 {
-  for (size_t row = region.row_min; row < region.row_max; ++row) {
-    for (size_t col = region.col_min; col < region.col_max; ++col) {
-      res_img->operator()(row, col) = region.pix.to_rgba_pixel().to_uint32_t();
-    }
+  auto region_view =
+    res_img->view(region.row_min, region.col_min, region.row_max - region.row_min, region.col_max - region.col_min);
+  uint32_t region_color = region.pix.to_rgba_pixel().to_uint32_t();
+  for (size_t row = 0; row < region_view.get_rows(); ++row) {
+    std::fill(region_view.row_ptr(row), region_view.row_ptr(row) + region_view.get_cols(), region_color);
   }
 }
 
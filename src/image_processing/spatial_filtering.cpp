@@ -1,154 +1,1153 @@
 #include "image_processing/spatial_filtering.h"
 
+#include "image_processing/fft_convolution.h"
+#include "image_processing/spatial_filtering_simd.h"
 #include "utils/constants.h"
+#include "utils/parallel.h"
+#include <algorithm>
+#include <array>
 #include <cmath>
 
 namespace ip {
-// GRAYSCALE
-void apply_kernel(std::shared_ptr<Matrix<uint8_t>> input_img,
-                  std::shared_ptr<Matrix<float>> kernel,
-                  std::shared_ptr<Matrix<uint8_t>> output_img)
+int border_index(int index, int size, BorderMode border_mode)
 {
-  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
-    output_img = std::make_shared<Matrix<uint8_t>>(input_img->get_rows(), input_img->get_cols());
+  if (index >= 0 && index < size) {
+    return index;
   }
-
-  for (size_t row = 0; row < input_img->get_rows(); ++row) {
-    for (size_t col = 0; col < input_img->get_cols(); ++col) {
-      output_img->operator()(row, col) = apply_kernel_on_pixel(input_img, kernel, row, col);
+  switch (border_mode) {
+    case BorderMode::REPLICATE:
+      return std::min(std::max(index, 0), size - 1);
+    case BorderMode::REFLECT: {
+      if (size == 1) {
+        return 0;
+      }
+      // Reflection is periodic, which also handles kernels larger than the image
+      int period = 2 * (size - 1);
+      index %= period;
+      index = index < 0 ? index + period : index;
+      return index < size ? index : period - index;
     }
+    case BorderMode::WRAP:
+      index %= size;
+      return index < 0 ? index + size : index;
+    default:
+      return -1;
   }
 }
 
-uint8_t apply_kernel_on_pixel(std::shared_ptr<Matrix<uint8_t>> input_img,
-                              std::shared_ptr<Matrix<float>> kernel,
-                              size_t row,
-                              size_t col)
+namespace {
+// Accumulators of the correlations, one float per channel
+template<typename T>
+struct KernelAccumulator
 {
-  int rows = input_img->get_rows();
-  int cols = input_img->get_cols();
-  int kernel_semi_rows = (kernel->get_rows() - 1) / 2;
-  int kernel_semi_cols = (kernel->get_cols() - 1) / 2;
   float acc = 0.f;
-  int acc_cpt = 0;
+  void add(T value, float weight) { acc += value * weight; };
+};
+
+template<>
+struct KernelAccumulator<uint32_t>
+{
+  float r_acc = 0.f;
+  float g_acc = 0.f;
+  float b_acc = 0.f;
+  void add(uint32_t rgba_pixel, float weight)
+  {
+    r_acc += ((rgba_pixel & 0xff000000) >> 24) * weight;
+    g_acc += ((rgba_pixel & 0x00ff0000) >> 16) * weight;
+    b_acc += ((rgba_pixel & 0x0000ff00) >> 8) * weight;
+  };
+};
+
+template<typename Out, typename In>
+Out store_response(const KernelAccumulator<In>& acc)
+{
+  return PixelTraits<Out>::saturate(std::abs(acc.acc));
+}
+
+uint32_t store_rgba_response(const KernelAccumulator<uint32_t>& acc)
+{
+  uint8_t r = PixelTraits<uint8_t>::saturate(std::abs(acc.r_acc));
+  uint8_t g = PixelTraits<uint8_t>::saturate(std::abs(acc.g_acc));
+  uint8_t b = PixelTraits<uint8_t>::saturate(std::abs(acc.b_acc));
+  return uint32_t(r << 24 | g << 16 | b << 8 | 255);
+}
+
+// Interior part of an output row. Taps are accumulated one after the other along the whole row through the
+// vectorized row primitives, which gives the same per pixel order (and results) as correlate_interior_pixel
+template<typename T>
+struct RowAccumulator
+{
+  std::vector<float> acc;
+  explicit RowAccumulator(size_t size)
+    : acc(size){};
+  void reset() { std::fill(acc.begin(), acc.end(), 0.f); };
+  void add(const T* input_row, float weight) { simd::accumulate_row(input_row, weight, acc.data(), acc.size()); };
+  template<size_t N, size_t M>
+  void correlate(const T* const* input_rows, const FixedKernel<N, M>& kernel)
+  {
+    simd::correlate_row(input_rows, kernel.coefficients, acc.data(), acc.size());
+  }
+  template<typename Out>
+  void store(Out* output_row) const
+  {
+    simd::store_row(acc.data(), output_row, acc.size());
+  }
+};
+
+template<>
+struct RowAccumulator<uint32_t>
+{
+  std::vector<float> r_acc, g_acc, b_acc;
+  explicit RowAccumulator(size_t size)
+    : r_acc(size)
+    , g_acc(size)
+    , b_acc(size){};
+  void reset()
+  {
+    std::fill(r_acc.begin(), r_acc.end(), 0.f);
+    std::fill(g_acc.begin(), g_acc.end(), 0.f);
+    std::fill(b_acc.begin(), b_acc.end(), 0.f);
+  };
+  void add(const uint32_t* input_row, float weight)
+  {
+    simd::accumulate_rgba_row(input_row, weight, r_acc.data(), g_acc.data(), b_acc.data(), r_acc.size());
+  };
+  template<size_t N, size_t M>
+  void correlate(const uint32_t* const* input_rows, const FixedKernel<N, M>& kernel)
+  {
+    simd::correlate_rgba_row(input_rows, kernel.coefficients, r_acc.data(), g_acc.data(), b_acc.data(), r_acc.size());
+  }
+  void store(uint32_t* output_row) const
+  {
+    simd::store_rgba_row(r_acc.data(), g_acc.data(), b_acc.data(), output_row, r_acc.size());
+  };
+};
+
+// Range [begin, end) of the pixels whose whole neighborhood lies inside [0, size), possibly empty
+struct InteriorRange
+{
+  size_t begin, end;
+};
 
-  for (size_t x = 0; x < kernel->get_rows(); ++x) {
-    for (size_t y = 0; y < kernel->get_cols(); ++y) {
-      // Check if indexes are in image
-      int row_index = row + x - kernel_semi_rows;
-      if (row_index < 0 || row_index >= rows) {
+InteriorRange interior_range(size_t size, size_t kernel_size)
+{
+  size_t begin = std::min((kernel_size - 1) / 2, size);
+  size_t end = size + begin + 1 > kernel_size ? size + begin + 1 - kernel_size : 0;
+  return InteriorRange{ begin, std::max(begin, end) };
+}
+
+// Correlation of a pixel whose neighborhood is inside the image, no check at all
+template<typename T>
+KernelAccumulator<T> correlate_interior_pixel(MatrixView<const T> input_img,
+                                              const Matrix<float>& kernel,
+                                              size_t row,
+                                              size_t col)
+{
+  KernelAccumulator<T> acc;
+  const T* input_row = input_img.row_ptr(row - (kernel.get_rows() - 1) / 2) + col - (kernel.get_cols() - 1) / 2;
+  for (size_t x = 0; x < kernel.get_rows(); ++x) {
+    const float* kernel_row = kernel.row_ptr(x);
+    for (size_t y = 0; y < kernel.get_cols(); ++y) {
+      acc.add(input_row[y], kernel_row[y]);
+    }
+    input_row += input_img.get_stride();
+  }
+  return acc;
+}
+
+// Correlation of a pixel close to the image border, every tap goes through border_index
+template<typename T>
+KernelAccumulator<T> correlate_border_pixel(MatrixView<const T> input_img,
+                                            const Matrix<float>& kernel,
+                                            size_t row,
+                                            size_t col,
+                                            BorderMode border_mode)
+{
+  int rows = input_img.get_rows();
+  int cols = input_img.get_cols();
+  int kernel_semi_rows = (kernel.get_rows() - 1) / 2;
+  int kernel_semi_cols = (kernel.get_cols() - 1) / 2;
+  KernelAccumulator<T> acc;
+
+  for (size_t x = 0; x < kernel.get_rows(); ++x) {
+    int row_index = border_index(int(row + x) - kernel_semi_rows, rows, border_mode);
+    if (row_index < 0) {
+      continue;
+    }
+    const T* input_row = input_img.row_ptr(row_index);
+    const float* kernel_row = kernel.row_ptr(x);
+    for (size_t y = 0; y < kernel.get_cols(); ++y) {
+      int col_index = border_index(int(col + y) - kernel_semi_cols, cols, border_mode);
+      if (col_index < 0) {
         continue;
       }
-      int col_index = col + y - kernel_semi_cols;
-      if (col_index < 0 || col_index >= cols) {
-        continue;
+      acc.add(input_row[col_index], kernel_row[y]);
+    }
+  }
+  return acc;
+}
+
+template<typename T>
+KernelAccumulator<T> correlate_pixel(MatrixView<const T> input_img,
+                                     const Matrix<float>& kernel,
+                                     size_t row,
+                                     size_t col,
+                                     BorderMode border_mode)
+{
+  InteriorRange rows = interior_range(input_img.get_rows(), kernel.get_rows());
+  InteriorRange cols = interior_range(input_img.get_cols(), kernel.get_cols());
+  if (row >= rows.begin && row < rows.end && col >= cols.begin && col < cols.end) {
+    return correlate_interior_pixel(input_img, kernel, row, col);
+  }
+  return correlate_border_pixel(input_img, kernel, row, col, border_mode);
+}
+
+// Applies a 2D kernel on a whole image. The interior region runs the branch-free row accumulation, only the frame
+// of (kernel size / 2) pixels around it goes through the border handling. store converts the accumulators of the
+// border pixels to pixels, it must match RowAccumulator::store. correlate_interior(acc, input_rows) fills the
+// accumulator of an interior row, from the rows of its first pixel neighborhood.
+// Bands of output rows run on the shared thread pool. Every output row only reads the input, so the result does not
+// depend on the number of threads
+template<typename In, typename Out, typename Store, typename CorrelateInterior>
+void correlate_image(MatrixView<const In> input_img,
+                     const Matrix<float>& kernel,
+                     MatrixView<Out> output_img,
+                     BorderMode border_mode,
+                     Store store,
+                     CorrelateInterior correlate_interior)
+{
+  InteriorRange rows = interior_range(input_img.get_rows(), kernel.get_rows());
+  InteriorRange cols = interior_range(input_img.get_cols(), kernel.get_cols());
+  size_t kernel_semi_rows = (kernel.get_rows() - 1) / 2;
+  size_t kernel_semi_cols = (kernel.get_cols() - 1) / 2;
+  utils::parallel_for(input_img.get_rows(), [&](size_t row_begin, size_t row_end) {
+    RowAccumulator<In> interior_acc(cols.end - cols.begin);
+    std::vector<const In*> input_rows(kernel.get_rows());
+    for (size_t row = row_begin; row < row_end; ++row) {
+      RowSpan<Out> output_row = output_img.row(row);
+      bool interior_row = row >= rows.begin && row < rows.end && cols.end > cols.begin;
+      size_t interior_begin = interior_row ? cols.begin : output_row.size();
+      size_t interior_end = interior_row ? cols.end : output_row.size();
+      for (size_t col = 0; col < interior_begin; ++col) {
+        output_row[col] = store(correlate_border_pixel(input_img, kernel, row, col, border_mode));
+      }
+      if (interior_row) {
+        for (size_t x = 0; x < kernel.get_rows(); ++x) {
+          input_rows[x] = input_img.row_ptr(row + x - kernel_semi_rows) + interior_begin - kernel_semi_cols;
+        }
+        correlate_interior(interior_acc, input_rows.data());
+        interior_acc.store(output_row.data() + interior_begin);
+      }
+      for (size_t col = interior_end; col < output_row.size(); ++col) {
+        output_row[col] = store(correlate_border_pixel(input_img, kernel, row, col, border_mode));
+      }
+    }
+  });
+}
+
+// Runtime kernels are accumulated tap after tap
+template<typename In, typename Out, typename Store>
+void correlate_image(MatrixView<const In> input_img,
+                     const Matrix<float>& kernel,
+                     MatrixView<Out> output_img,
+                     BorderMode border_mode,
+                     Store store)
+{
+  auto correlate_interior = [&kernel](RowAccumulator<In>& acc, const In* const* input_rows) {
+    acc.reset();
+    for (size_t x = 0; x < kernel.get_rows(); ++x) {
+      const float* kernel_row = kernel.row_ptr(x);
+      for (size_t y = 0; y < kernel.get_cols(); ++y) {
+        acc.add(input_rows[x] + y, kernel_row[y]);
+      }
+    }
+  };
+  correlate_image(input_img, kernel, output_img, border_mode, store, correlate_interior);
+}
+
+// Fixed kernels run their unrolled taps on the interior, the border pixels use a runtime copy of the kernel
+template<size_t N, size_t M, typename In, typename Out, typename Store>
+void correlate_image(MatrixView<const In> input_img,
+                     const FixedKernel<N, M>& kernel,
+                     MatrixView<Out> output_img,
+                     BorderMode border_mode,
+                     Store store)
+{
+  auto correlate_interior = [&kernel](RowAccumulator<In>& acc, const In* const* input_rows) {
+    acc.correlate(input_rows, kernel);
+  };
+  correlate_image(input_img, *kernel.to_matrix(), output_img, border_mode, store, correlate_interior);
+}
+
+// Horizontal pass of a separable kernel, the response is kept in float for the vertical pass
+template<typename In>
+void correlate_rows(MatrixView<const In> input_img,
+                    const std::vector<float>& kernel,
+                    MatrixView<float> output_img,
+                    BorderMode border_mode)
+{
+  int cols = input_img.get_cols();
+  int kernel_size = kernel.size();
+  int kernel_semi_size = (kernel_size - 1) / 2;
+  InteriorRange interior = interior_range(cols, kernel_size);
+  auto correlate_border = [&](const In* input_row, int col) {
+    float acc = 0.f;
+    for (int y = 0; y < kernel_size; ++y) {
+      int col_index = border_index(col + y - kernel_semi_size, cols, border_mode);
+      if (col_index >= 0) {
+        acc += input_row[col_index] * kernel[y];
+      }
+    }
+    return acc;
+  };
+
+  utils::parallel_for(input_img.get_rows(), [&](size_t row_begin, size_t row_end) {
+    for (size_t row = row_begin; row < row_end; ++row) {
+      const In* input_row = input_img.row_ptr(row);
+      float* output_row = output_img.row_ptr(row);
+      int interior_begin = interior.begin;
+      int interior_end = interior.end;
+      for (int col = 0; col < interior_begin; ++col) {
+        output_row[col] = correlate_border(input_row, col);
+      }
+      if (interior_end > interior_begin) {
+        std::fill(output_row + interior_begin, output_row + interior_end, 0.f);
+        for (int y = 0; y < kernel_size; ++y) {
+          const In* input_px = input_row + interior_begin - kernel_semi_size + y;
+          simd::accumulate_row(input_px, kernel[y], output_row + interior_begin, interior_end - interior_begin);
+        }
+      }
+      for (int col = interior_end; col < cols; ++col) {
+        output_row[col] = correlate_border(input_row, col);
+      }
+    }
+  });
+}
+
+// Vertical pass of a separable kernel. Whole input rows are accumulated one after the other, so that the inner loop
+// runs along contiguous memory. store(row, acc) receives the final responses of each output row, it is called from
+// the pool threads, on distinct rows
+template<typename Store>
+void correlate_cols(MatrixView<const float> input_img,
+                    const std::vector<float>& kernel,
+                    BorderMode border_mode,
+                    Store store)
+{
+  int rows = input_img.get_rows();
+  int kernel_semi_size = (int(kernel.size()) - 1) / 2;
+  utils::parallel_for(size_t(rows), [&](size_t row_begin, size_t row_end) {
+    std::vector<float> acc(input_img.get_cols());
+    for (int row = int(row_begin); row < int(row_end); ++row) {
+      std::fill(acc.begin(), acc.end(), 0.f);
+      for (size_t x = 0; x < kernel.size(); ++x) {
+        int row_index = border_index(row + int(x) - kernel_semi_size, rows, border_mode);
+        if (row_index < 0) {
+          continue;
+        }
+        simd::accumulate_row(input_img.row_ptr(row_index), kernel[x], acc.data(), acc.size());
+      }
+      store(size_t(row), acc.data());
+    }
+  });
+}
+}
+
+bool decompose_separable_kernel(const Matrix<float>& kernel, SeparableKernel& separable_kernel)
+{
+  // Pivot on the largest coefficient, its row and column give the two 1D kernels
+  size_t pivot_row = 0, pivot_col = 0;
+  float max_abs = 0.f;
+  for (size_t x = 0; x < kernel.get_rows(); ++x) {
+    for (size_t y = 0; y < kernel.get_cols(); ++y) {
+      if (std::abs(kernel(x, y)) > max_abs) {
+        max_abs = std::abs(kernel(x, y));
+        pivot_row = x;
+        pivot_col = y;
+      }
+    }
+  }
+  if (max_abs == 0.f) {
+    return false;
+  }
+
+  float pivot = kernel(pivot_row, pivot_col);
+  std::vector<float> vertical(kernel.get_rows()), horizontal(kernel.get_cols());
+  for (size_t x = 0; x < kernel.get_rows(); ++x) {
+    vertical[x] = kernel(x, pivot_col);
+  }
+  for (size_t y = 0; y < kernel.get_cols(); ++y) {
+    horizontal[y] = kernel(pivot_row, y) / pivot;
+  }
+
+  // Rank-1 check
+  for (size_t x = 0; x < kernel.get_rows(); ++x) {
+    for (size_t y = 0; y < kernel.get_cols(); ++y) {
+      if (std::abs(kernel(x, y) - vertical[x] * horizontal[y]) > SEPARABLE_KERNEL_TOLERANCE * max_abs) {
+        return false;
       }
-      ++acc_cpt;
-      acc += input_img->operator()(row_index, col_index) * kernel->operator()(x, y);
     }
   }
-  return uint8_t(std::sqrt(std::pow(acc, 2.f)));
+  separable_kernel = SeparableKernel{ std::move(vertical), std::move(horizontal) };
+  return true;
+}
+
+// SINGLE CHANNEL
+template<typename In, typename Out>
+void apply_kernel(MatrixView<const In> input_img,
+                  const SeparableKernel& kernel,
+                  MatrixView<Out> output_img,
+                  BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+
+  Matrix<float> h_response(input_img.get_rows(), input_img.get_cols());
+  correlate_rows(input_img, kernel.horizontal, h_response.view(), border_mode);
+  correlate_cols(h_response.view(), kernel.vertical, border_mode, [&output_img](size_t row, const float* acc) {
+    simd::store_row(acc, output_img.row_ptr(row), output_img.get_cols());
+  });
+}
+
+template<typename In, typename Out>
+void apply_kernel(std::shared_ptr<Matrix<In>> input_img,
+                  std::shared_ptr<Matrix<float>> kernel,
+                  std::shared_ptr<Matrix<Out>> output_img,
+                  BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<Out>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  apply_kernel<In, Out>(input_img->view(), *kernel, output_img->view(), border_mode);
+}
+
+template<typename T>
+T apply_kernel_on_pixel(std::shared_ptr<Matrix<T>> input_img,
+                        std::shared_ptr<Matrix<float>> kernel,
+                        size_t row,
+                        size_t col,
+                        BorderMode border_mode)
+{
+  return apply_kernel_on_pixel<T>(input_img->view(), *kernel, row, col, border_mode);
+}
+
+template<typename In, typename Out>
+void apply_kernel(MatrixView<const In> input_img,
+                  const Matrix<float>& kernel,
+                  MatrixView<Out> output_img,
+                  BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+
+  // Rank-1 kernels run as two 1D passes, large kernels through FFTs
+  SeparableKernel separable_kernel;
+  bool separable =
+    kernel.get_rows() > 1 && kernel.get_cols() > 1 && decompose_separable_kernel(kernel, separable_kernel);
+  if (use_fft_convolution(kernel, separable)) {
+    apply_kernel_fft<In, Out>(input_img, kernel, output_img, border_mode);
+    return;
+  }
+  if (separable) {
+    apply_kernel<In, Out>(input_img, separable_kernel, output_img, border_mode);
+    return;
+  }
+
+  correlate_image(input_img, kernel, output_img, border_mode, store_response<Out, In>);
+}
+
+template<typename T>
+T apply_kernel_on_pixel(MatrixView<const T> input_img,
+                        const Matrix<float>& kernel,
+                        size_t row,
+                        size_t col,
+                        BorderMode border_mode)
+{
+  return store_response<T, T>(correlate_pixel(input_img, kernel, row, col, border_mode));
+}
+
+template<typename T>
+float apply_kernel_on_pixel_float(std::shared_ptr<Matrix<T>> input_img,
+                                  std::shared_ptr<Matrix<float>> kernel,
+                                  size_t row,
+                                  size_t col,
+                                  BorderMode border_mode)
+{
+  return apply_kernel_on_pixel_float<T>(input_img->view(), *kernel, row, col, border_mode);
+}
+
+template<typename T>
+float apply_kernel_on_pixel_float(MatrixView<const T> input_img,
+                                  const Matrix<float>& kernel,
+                                  size_t row,
+                                  size_t col,
+                                  BorderMode border_mode)
+{
+  return std::abs(correlate_pixel(input_img, kernel, row, col, border_mode).acc);
 }
 
+// Supported formats, a new format only needs its PixelTraits and a few lines here
+#define INSTANTIATE_APPLY_KERNEL(In, Out)                                                                             \
+  template void apply_kernel<In, Out>(                                                                                \
+    std::shared_ptr<Matrix<In>>, std::shared_ptr<Matrix<float>>, std::shared_ptr<Matrix<Out>>, BorderMode);           \
+  template void apply_kernel<In, Out>(MatrixView<const In>, const Matrix<float>&, MatrixView<Out>, BorderMode);       \
+  template void apply_kernel<In, Out>(MatrixView<const In>, const SeparableKernel&, MatrixView<Out>, BorderMode);
+
+#define INSTANTIATE_APPLY_KERNEL_ON_PIXEL(T)                                                                          \
+  template T apply_kernel_on_pixel<T>(                                                                                \
+    std::shared_ptr<Matrix<T>>, std::shared_ptr<Matrix<float>>, size_t, size_t, BorderMode);                          \
+  template T apply_kernel_on_pixel<T>(MatrixView<const T>, const Matrix<float>&, size_t, size_t, BorderMode);         \
+  template float apply_kernel_on_pixel_float<T>(                                                                      \
+    std::shared_ptr<Matrix<T>>, std::shared_ptr<Matrix<float>>, size_t, size_t, BorderMode);                          \
+  template float apply_kernel_on_pixel_float<T>(MatrixView<const T>, const Matrix<float>&, size_t, size_t, BorderMode);
+
+INSTANTIATE_APPLY_KERNEL(uint8_t, uint8_t)
+INSTANTIATE_APPLY_KERNEL(uint16_t, uint16_t)
+INSTANTIATE_APPLY_KERNEL(float, float)
+INSTANTIATE_APPLY_KERNEL(uint8_t, float)
+INSTANTIATE_APPLY_KERNEL(uint16_t, float)
+INSTANTIATE_APPLY_KERNEL_ON_PIXEL(uint8_t)
+INSTANTIATE_APPLY_KERNEL_ON_PIXEL(uint16_t)
+INSTANTIATE_APPLY_KERNEL_ON_PIXEL(float)
+
 // RGBA
+namespace {
+// Rows per band of the separable RGBA path
+const size_t SEPARABLE_RGBA_BAND_ROWS = 64;
+}
+
 void apply_kernel(std::shared_ptr<Matrix<uint32_t>> input_img,
                   std::shared_ptr<Matrix<float>> kernel,
-                  std::shared_ptr<Matrix<uint32_t>> output_img)
+                  std::shared_ptr<Matrix<uint32_t>> output_img,
+                  BorderMode border_mode)
 {
   if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
-    output_img = std::make_shared<Matrix<uint32_t>>(input_img->get_rows(), input_img->get_cols());
+    *output_img = Matrix<uint32_t>(input_img->get_rows(), input_img->get_cols());
   }
 
-  for (size_t row = 0; row < input_img->get_rows(); ++row) {
-    for (size_t col = 0; col < input_img->get_cols(); ++col) {
-      output_img->operator()(row, col) = apply_kernel_on_pixel(input_img, kernel, row, col);
-    }
-  }
+  apply_kernel(input_img->view(), *kernel, output_img->view(), border_mode);
 }
 
 uint32_t apply_kernel_on_pixel(std::shared_ptr<Matrix<uint32_t>> input_img,
                                std::shared_ptr<Matrix<float>> kernel,
                                size_t row,
-                               size_t col)
+                               size_t col,
+                               BorderMode border_mode)
 {
-  int rows = input_img->get_rows();
-  int cols = input_img->get_cols();
-  int kernel_semi_rows = (kernel->get_rows() - 1) / 2;
-  int kernel_semi_cols = (kernel->get_cols() - 1) / 2;
-  float r_acc = 0.f;
-  float g_acc = 0.f;
-  float b_acc = 0.f;
-  int acc_cpt = 0;
+  return apply_kernel_on_pixel(input_img->view(), *kernel, row, col, border_mode);
+}
+
+void apply_kernel(MatrixView<const uint32_t> input_img,
+                  const Matrix<float>& kernel,
+                  MatrixView<uint32_t> output_img,
+                  BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+
+  SeparableKernel separable_kernel;
+  bool separable =
+    kernel.get_rows() > 1 && kernel.get_cols() > 1 && decompose_separable_kernel(kernel, separable_kernel);
+  if (use_fft_convolution(kernel, separable)) {
+    apply_kernel_fft(input_img, kernel, output_img, border_mode);
+    return;
+  }
+  if (separable) {
+    apply_kernel(input_img, separable_kernel, output_img, border_mode);
+    return;
+  }
+
+  correlate_image(input_img, kernel, output_img, border_mode, store_rgba_response);
+}
+
+uint32_t apply_kernel_on_pixel(MatrixView<const uint32_t> input_img,
+                               const Matrix<float>& kernel,
+                               size_t row,
+                               size_t col,
+                               BorderMode border_mode)
+{
+  return store_rgba_response(correlate_pixel(input_img, kernel, row, col, border_mode));
+}
+
+void apply_kernel(MatrixView<const uint32_t> input_img,
+                  const SeparableKernel& kernel,
+                  MatrixView<uint32_t> output_img,
+                  BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
 
-  for (size_t x = 0; x < kernel->get_rows(); ++x) {
-    for (size_t y = 0; y < kernel->get_cols(); ++y) {
-      // Check if indexes are in image
-      int row_index = row + x - kernel_semi_rows;
-      if (row_index < 0 || row_index >= rows) {
+  // Every band of output rows deinterleaves the input rows it reads into R, G and B planes and runs the horizontal
+  // pass on them as on gray images. The vertical pass then accumulates the three channels and packs them once. Rows
+  // read by two bands go through the horizontal pass twice, large bands keep that overhead low
+  int rows = input_img.get_rows();
+  size_t cols = input_img.get_cols();
+  int kernel_semi_size = (int(kernel.vertical.size()) - 1) / 2;
+  auto filter_band = [&](size_t row_begin, size_t row_end) {
+    // Band row of the (row_begin - kernel_semi_size + i)-th row, -1 when it is outside of the image
+    std::vector<int> band_rows(row_end - row_begin + kernel.vertical.size() - 1);
+    int n_band_rows = 0;
+    for (size_t i = 0; i < band_rows.size(); ++i) {
+      int row_index = border_index(int(row_begin + i) - kernel_semi_size, rows, border_mode);
+      band_rows[i] = row_index < 0 ? -1 : n_band_rows++;
+    }
+
+    std::array<Matrix<uint8_t>, 3> planes;
+    std::array<Matrix<float>, 3> h_responses;
+    for (size_t channel = 0; channel < planes.size(); ++channel) {
+      planes[channel] = Matrix<uint8_t>(n_band_rows, cols);
+      h_responses[channel] = Matrix<float>(n_band_rows, cols);
+    }
+    for (size_t i = 0; i < band_rows.size(); ++i) {
+      if (band_rows[i] < 0) {
         continue;
       }
-      int col_index = col + y - kernel_semi_cols;
-      if (col_index < 0 || col_index >= cols) {
-        continue;
+      const uint32_t* input_row =
+        input_img.row_ptr(border_index(int(row_begin + i) - kernel_semi_size, rows, border_mode));
+      uint8_t* r_row = planes[0].row_ptr(band_rows[i]);
+      uint8_t* g_row = planes[1].row_ptr(band_rows[i]);
+      uint8_t* b_row = planes[2].row_ptr(band_rows[i]);
+      for (size_t col = 0; col < cols; ++col) {
+        r_row[col] = uint8_t(input_row[col] >> 24);
+        g_row[col] = uint8_t(input_row[col] >> 16);
+        b_row[col] = uint8_t(input_row[col] >> 8);
       }
-      ++acc_cpt;
+    }
+    for (size_t channel = 0; channel < planes.size(); ++channel) {
+      correlate_rows(
+        MatrixView<const uint8_t>(planes[channel].view()), kernel.horizontal, h_responses[channel].view(), border_mode);
+    }
 
-      uint32_t rgba_pixel = input_img->operator()(row_index, col_index);
-      r_acc += ((rgba_pixel & 0xff000000) >> 24) * kernel->operator()(x, y);
-      g_acc += ((rgba_pixel & 0x00ff0000) >> 16) * kernel->operator()(x, y);
-      b_acc += ((rgba_pixel & 0x0000ff00) >> 8) * kernel->operator()(x, y);
+    // Same order of the taps as correlate_cols
+    std::array<std::vector<float>, 3> acc;
+    for (std::vector<float>& channel_acc : acc) {
+      channel_acc.resize(cols);
+    }
+    for (size_t row = row_begin; row < row_end; ++row) {
+      for (size_t channel = 0; channel < acc.size(); ++channel) {
+        std::fill(acc[channel].begin(), acc[channel].end(), 0.f);
+        for (size_t x = 0; x < kernel.vertical.size(); ++x) {
+          int band_row = band_rows[row - row_begin + x];
+          if (band_row >= 0) {
+            simd::accumulate_row(h_responses[channel].row_ptr(band_row), kernel.vertical[x], acc[channel].data(), cols);
+          }
+        }
+      }
+      simd::store_rgba_row(acc[0].data(), acc[1].data(), acc[2].data(), output_img.row_ptr(row), cols);
     }
+  };
+  utils::parallel_for(input_img.get_rows(), filter_band, SEPARABLE_RGBA_BAND_ROWS);
+}
+
+// FIXED SIZE KERNELS
+template<size_t N, size_t M, typename In, typename Out>
+void apply_kernel(std::shared_ptr<Matrix<In>> input_img,
+                  const FixedKernel<N, M>& kernel,
+                  std::shared_ptr<Matrix<Out>> output_img,
+                  BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<Out>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  apply_kernel<N, M, In, Out>(input_img->view(), kernel, output_img->view(), border_mode);
+}
+
+template<size_t N, size_t M, typename In, typename Out>
+void apply_kernel(MatrixView<const In> input_img,
+                  const FixedKernel<N, M>& kernel,
+                  MatrixView<Out> output_img,
+                  BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+
+  // From 5x5 up, two 1D passes of a rank-1 kernel (2N taps) beat the N^2 unrolled taps
+  SeparableKernel separable_kernel;
+  if (N >= 5 && M >= 5 && decompose_separable_kernel(*kernel.to_matrix(), separable_kernel)) {
+    apply_kernel<In, Out>(input_img, separable_kernel, output_img, border_mode);
+    return;
+  }
+
+  correlate_image(input_img, kernel, output_img, border_mode, store_response<Out, In>);
+}
+
+template<size_t N, size_t M>
+void apply_kernel(std::shared_ptr<Matrix<uint32_t>> input_img,
+                  const FixedKernel<N, M>& kernel,
+                  std::shared_ptr<Matrix<uint32_t>> output_img,
+                  BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<uint32_t>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  apply_kernel<N, M>(input_img->view(), kernel, output_img->view(), border_mode);
+}
+
+template<size_t N, size_t M>
+void apply_kernel(MatrixView<const uint32_t> input_img,
+                  const FixedKernel<N, M>& kernel,
+                  MatrixView<uint32_t> output_img,
+                  BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+
+  SeparableKernel separable_kernel;
+  if (N >= 5 && M >= 5 && decompose_separable_kernel(*kernel.to_matrix(), separable_kernel)) {
+    apply_kernel(input_img, separable_kernel, output_img, border_mode);
+    return;
   }
-  r_acc = std::sqrt(std::pow(r_acc, 2.f));
-  g_acc = std::sqrt(std::pow(g_acc, 2.f));
-  b_acc = std::sqrt(std::pow(b_acc, 2.f));
-  return uint32_t(uint8_t(r_acc) << 24 | uint8_t(g_acc) << 16 | uint8_t(b_acc) << 8 | 255);
+
+  correlate_image(input_img, kernel, output_img, border_mode, store_rgba_response);
 }
 
-// Float version
-void apply_kernel(std::shared_ptr<Matrix<uint8_t>> input_img,
+template<size_t N, size_t M>
+void apply_kernel(std::shared_ptr<PlanarImage> input_img,
+                  const FixedKernel<N, M>& kernel,
+                  std::shared_ptr<PlanarImage> output_img,
+                  BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = PlanarImage(input_img->get_rows(), input_img->get_cols());
+  }
+
+  for (size_t channel : { PlanarImage::R, PlanarImage::G, PlanarImage::B }) {
+    apply_kernel<N, M, uint8_t, uint8_t>(
+      input_img->plane(channel).view(), kernel, output_img->plane(channel).view(), border_mode);
+  }
+  output_img->fill_alpha();
+}
+
+#define INSTANTIATE_FIXED_APPLY_KERNEL(N, M, In, Out)                                                                 \
+  template void apply_kernel<N, M, In, Out>(                                                                          \
+    std::shared_ptr<Matrix<In>>, const FixedKernel<N, M>&, std::shared_ptr<Matrix<Out>>, BorderMode);                 \
+  template void apply_kernel<N, M, In, Out>(                                                                          \
+    MatrixView<const In>, const FixedKernel<N, M>&, MatrixView<Out>, BorderMode);
+
+#define INSTANTIATE_FIXED_KERNEL(N, M)                                                                                \
+  INSTANTIATE_FIXED_APPLY_KERNEL(N, M, uint8_t, uint8_t)                                                              \
+  INSTANTIATE_FIXED_APPLY_KERNEL(N, M, uint16_t, uint16_t)                                                            \
+  INSTANTIATE_FIXED_APPLY_KERNEL(N, M, float, float)                                                                  \
+  INSTANTIATE_FIXED_APPLY_KERNEL(N, M, uint8_t, float)                                                                \
+  INSTANTIATE_FIXED_APPLY_KERNEL(N, M, uint16_t, float)                                                               \
+  template void apply_kernel<N, M>(                                                                                   \
+    std::shared_ptr<Matrix<uint32_t>>, const FixedKernel<N, M>&, std::shared_ptr<Matrix<uint32_t>>, BorderMode);      \
+  template void apply_kernel<N, M>(                                                                                   \
+    MatrixView<const uint32_t>, const FixedKernel<N, M>&, MatrixView<uint32_t>, BorderMode);                          \
+  template void apply_kernel<N, M>(                                                                                   \
+    std::shared_ptr<PlanarImage>, const FixedKernel<N, M>&, std::shared_ptr<PlanarImage>, BorderMode);
+
+INSTANTIATE_FIXED_KERNEL(3, 3)
+INSTANTIATE_FIXED_KERNEL(5, 5)
+
+// PLANAR
+void apply_kernel(std::shared_ptr<PlanarImage> input_img,
                   std::shared_ptr<Matrix<float>> kernel,
-                  std::shared_ptr<Matrix<float>> output_img)
+                  std::shared_ptr<PlanarImage> output_img,
+                  BorderMode border_mode)
 {
   if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
-    output_img = std::make_shared<Matrix<float>>(input_img->get_rows(), input_img->get_cols());
+    *output_img = PlanarImage(input_img->get_rows(), input_img->get_cols());
+  }
+
+  for (size_t channel : { PlanarImage::R, PlanarImage::G, PlanarImage::B }) {
+    apply_kernel<uint8_t, uint8_t>(
+      input_img->plane(channel).view(), *kernel, output_img->plane(channel).view(), border_mode);
+  }
+  output_img->fill_alpha();
+}
+
+// FILTER BANKS
+namespace {
+// Interior pixels of a row handled at once by every kernel of a bank, their neighborhood stays in the L1 cache
+const size_t FILTER_BANK_CHUNK = 512;
+
+struct BankTap
+{
+  size_t row, col;
+  float weight;
+};
+
+// Filter bank on a whole image, following the layout of correlate_image. Interior rows are cut in chunks and every
+// kernel runs on a chunk before moving to the next one. Zero taps do not change the sums and are skipped, the other
+// ones are accumulated in the order of correlate_image, so each response is the one of apply_kernel.
+// store(row, col, responses, size) receives the responses of size pixels from (row, col), responses[k] being the
+// ones of the k-th kernel. It is called from the pool threads, on distinct pixels
+template<typename In, typename Store>
+void correlate_image_bank(MatrixView<const In> input_img,
+                          const std::vector<Matrix<float>>& kernels,
+                          BorderMode border_mode,
+                          Store store)
+{
+  if (kernels.empty()) {
+    return;
+  }
+  const Matrix<float>& kernel = kernels.front();
+  std::vector<std::vector<BankTap>> taps(kernels.size());
+  for (size_t k = 0; k < kernels.size(); ++k) {
+    assert(kernels[k].get_rows() == kernel.get_rows() && kernels[k].get_cols() == kernel.get_cols());
+    for (size_t x = 0; x < kernel.get_rows(); ++x) {
+      for (size_t y = 0; y < kernel.get_cols(); ++y) {
+        if (kernels[k](x, y) != 0.f) {
+          taps[k].push_back(BankTap{ x, y, kernels[k](x, y) });
+        }
+      }
+    }
   }
 
-  for (size_t row = 0; row < input_img->get_rows(); ++row) {
-    for (size_t col = 0; col < input_img->get_cols(); ++col) {
-      output_img->operator()(row, col) = apply_kernel_on_pixel_float(input_img, kernel, row, col);
+  InteriorRange rows = interior_range(input_img.get_rows(), kernel.get_rows());
+  InteriorRange cols = interior_range(input_img.get_cols(), kernel.get_cols());
+  size_t kernel_semi_rows = (kernel.get_rows() - 1) / 2;
+  size_t kernel_semi_cols = (kernel.get_cols() - 1) / 2;
+  utils::parallel_for(input_img.get_rows(), [&](size_t row_begin, size_t row_end) {
+    std::vector<std::vector<float>> interior_acc(kernels.size(), std::vector<float>(FILTER_BANK_CHUNK));
+    std::vector<float> border_acc(kernels.size());
+    std::vector<const float*> responses(kernels.size());
+    auto correlate_border = [&](size_t row, size_t col) {
+      for (size_t k = 0; k < kernels.size(); ++k) {
+        border_acc[k] = correlate_border_pixel(input_img, kernels[k], row, col, border_mode).acc;
+        responses[k] = &border_acc[k];
+      }
+      store(row, col, responses.data(), 1);
+    };
+
+    for (size_t row = row_begin; row < row_end; ++row) {
+      bool interior_row = row >= rows.begin && row < rows.end && cols.end > cols.begin;
+      size_t interior_begin = interior_row ? cols.begin : input_img.get_cols();
+      size_t interior_end = interior_row ? cols.end : input_img.get_cols();
+      for (size_t col = 0; col < interior_begin; ++col) {
+        correlate_border(row, col);
+      }
+      for (size_t chunk = interior_begin; chunk < interior_end; chunk += FILTER_BANK_CHUNK) {
+        size_t size = std::min(FILTER_BANK_CHUNK, interior_end - chunk);
+        for (size_t k = 0; k < kernels.size(); ++k) {
+          float* acc = interior_acc[k].data();
+          std::fill(acc, acc + size, 0.f);
+          for (const BankTap& tap : taps[k]) {
+            const In* input = input_img.row_ptr(row + tap.row - kernel_semi_rows) + chunk + tap.col - kernel_semi_cols;
+            simd::accumulate_row(input, tap.weight, acc, size);
+          }
+          responses[k] = acc;
+        }
+        store(row, chunk, responses.data(), size);
+      }
+      for (size_t col = interior_end; col < input_img.get_cols(); ++col) {
+        correlate_border(row, col);
+      }
     }
+  });
+}
+
+std::vector<Matrix<float>> copy_kernels(const std::vector<std::shared_ptr<Matrix<float>>>& kernels)
+{
+  std::vector<Matrix<float>> kernel_copies;
+  for (const auto& kernel : kernels) {
+    kernel_copies.push_back(*kernel);
   }
+  return kernel_copies;
+}
 }
 
-float apply_kernel_on_pixel_float(std::shared_ptr<Matrix<uint8_t>> input_img,
-                                  std::shared_ptr<Matrix<float>> kernel,
-                                  size_t row,
-                                  size_t col)
+template<typename In, typename Out>
+void apply_kernels(std::shared_ptr<Matrix<In>> input_img,
+                   const std::vector<std::shared_ptr<Matrix<float>>>& kernels,
+                   const std::vector<std::shared_ptr<Matrix<Out>>>& output_imgs,
+                   BorderMode border_mode)
 {
-  int rows = input_img->get_rows();
-  int cols = input_img->get_cols();
-  int kernel_semi_rows = (kernel->get_rows() - 1) / 2;
-  int kernel_semi_cols = (kernel->get_cols() - 1) / 2;
-  float acc = 0.f;
-  int acc_cpt = 0;
+  std::vector<MatrixView<Out>> output_views;
+  for (const auto& output_img : output_imgs) {
+    if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+      *output_img = Matrix<Out>(input_img->get_rows(), input_img->get_cols());
+    }
+    output_views.push_back(output_img->view());
+  }
 
-  for (size_t x = 0; x < kernel->get_rows(); ++x) {
-    for (size_t y = 0; y < kernel->get_cols(); ++y) {
-      // Check if indexes are in image
-      int row_index = row + x - kernel_semi_rows;
-      if (row_index < 0 || row_index >= rows) {
-        continue;
+  apply_kernels<In, Out>(input_img->view(), copy_kernels(kernels), output_views, border_mode);
+}
+
+template<typename In, typename Out>
+void apply_kernels(MatrixView<const In> input_img,
+                   const std::vector<Matrix<float>>& kernels,
+                   const std::vector<MatrixView<Out>>& output_imgs,
+                   BorderMode border_mode)
+{
+  assert(kernels.size() == output_imgs.size());
+  for (size_t k = 0; k < output_imgs.size(); ++k) {
+    assert(input_img.get_rows() == output_imgs[k].get_rows() && input_img.get_cols() == output_imgs[k].get_cols());
+  }
+
+  auto store = [&output_imgs](size_t row, size_t col, const float* const* responses, size_t size) {
+    for (size_t k = 0; k < output_imgs.size(); ++k) {
+      simd::store_row(responses[k], output_imgs[k].row_ptr(row) + col, size);
+    }
+  };
+  correlate_image_bank(input_img, kernels, border_mode, store);
+}
+
+template<typename In, typename Out>
+void apply_kernels_magnitude(std::shared_ptr<Matrix<In>> input_img,
+                             const std::vector<std::shared_ptr<Matrix<float>>>& kernels,
+                             std::shared_ptr<Matrix<Out>> output_img,
+                             BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<Out>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  apply_kernels_magnitude<In, Out>(input_img->view(), copy_kernels(kernels), output_img->view(), border_mode);
+}
+
+template<typename In, typename Out>
+void apply_kernels_magnitude(MatrixView<const In> input_img,
+                             const std::vector<Matrix<float>>& kernels,
+                             MatrixView<Out> output_img,
+                             BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+
+  size_t n_kernels = kernels.size();
+  auto store = [&output_img, n_kernels](size_t row, size_t col, const float* const* responses, size_t size) {
+    Out* output_row = output_img.row_ptr(row) + col;
+    for (size_t i = 0; i < size; ++i) {
+      float squared_sum = 0.f;
+      for (size_t k = 0; k < n_kernels; ++k) {
+        squared_sum += responses[k][i] * responses[k][i];
       }
-      int col_index = col + y - kernel_semi_cols;
-      if (col_index < 0 || col_index >= cols) {
-        continue;
+      output_row[i] = PixelTraits<Out>::saturate(std::sqrt(squared_sum));
+    }
+  };
+  correlate_image_bank(input_img, kernels, border_mode, store);
+}
+
+#define INSTANTIATE_APPLY_KERNELS(In, Out)                                                                            \
+  template void apply_kernels<In, Out>(std::shared_ptr<Matrix<In>>,                                                   \
+                                       const std::vector<std::shared_ptr<Matrix<float>>>&,                            \
+                                       const std::vector<std::shared_ptr<Matrix<Out>>>&,                              \
+                                       BorderMode);                                                                   \
+  template void apply_kernels<In, Out>(                                                                               \
+    MatrixView<const In>, const std::vector<Matrix<float>>&, const std::vector<MatrixView<Out>>&, BorderMode);        \
+  template void apply_kernels_magnitude<In, Out>(                                                                     \
+    std::shared_ptr<Matrix<In>>, const std::vector<std::shared_ptr<Matrix<float>>>&, std::shared_ptr<Matrix<Out>>,    \
+    BorderMode);                                                                                                      \
+  template void apply_kernels_magnitude<In, Out>(                                                                     \
+    MatrixView<const In>, const std::vector<Matrix<float>>&, MatrixView<Out>, BorderMode);
+
+INSTANTIATE_APPLY_KERNELS(uint8_t, uint8_t)
+INSTANTIATE_APPLY_KERNELS(uint16_t, uint16_t)
+INSTANTIATE_APPLY_KERNELS(float, float)
+INSTANTIATE_APPLY_KERNELS(uint8_t, float)
+INSTANTIATE_APPLY_KERNELS(uint16_t, float)
+
+// FIXED POINT
+bool quantize_kernel(const Matrix<float>& kernel, FixedPointKernel& fixed_point_kernel)
+{
+  double max_abs = 0.;
+  for (size_t x = 0; x < kernel.get_rows(); ++x) {
+    for (size_t y = 0; y < kernel.get_cols(); ++y) {
+      max_abs = std::max(max_abs, double(std::abs(kernel(x, y))));
+    }
+  }
+  if (max_abs == 0. || std::round(max_abs) > INT16_MAX) {
+    return false;
+  }
+
+  int shift = 0;
+  while (shift < 30 && std::round(std::ldexp(max_abs, shift + 1)) <= INT16_MAX) {
+    ++shift;
+  }
+  // Every weight is rounded by at most half a unit, so a response moves by at most taps * 255 / 2^(shift + 1)
+  size_t taps = kernel.get_rows() * kernel.get_cols();
+  if (double(taps) * 255. > std::ldexp(1., shift)) {
+    return false;
+  }
+
+  FixedPointKernel quantized_kernel{ kernel.get_rows(), kernel.get_cols(), std::vector<int16_t>(taps), shift };
+  int64_t abs_sum = 0;
+  for (size_t x = 0; x < kernel.get_rows(); ++x) {
+    for (size_t y = 0; y < kernel.get_cols(); ++y) {
+      int16_t weight = int16_t(std::lround(std::ldexp(double(kernel(x, y)), shift)));
+      quantized_kernel.weights[x * kernel.get_cols() + y] = weight;
+      abs_sum += std::abs(weight);
+    }
+  }
+  if (abs_sum * 255 > INT32_MAX) {
+    return false;
+  }
+  fixed_point_kernel = std::move(quantized_kernel);
+  return true;
+}
+
+namespace {
+struct FixedPointTap
+{
+  size_t row, col;
+  int16_t weight;
+};
+
+// Direct correlation of an image of interleaved 8 bits channels (1 for gray images, 4 for packed RGBA read as bytes),
+// following the layout of correlate_image: interior rows go through the row primitive with the non zero taps only,
+// the frame goes through border_index. Integer sums make the result independent of the order of the taps.
+// finish_row(row) is called once each output row is written, while it is still in cache
+template<typename FinishRow>
+void correlate_image_fixed_point(MatrixView<const uint8_t> input_img,
+                                 size_t channels,
+                                 const FixedPointKernel& kernel,
+                                 MatrixView<uint8_t> output_img,
+                                 BorderMode border_mode,
+                                 FinishRow finish_row)
+{
+  assert(channels <= 4);
+  std::vector<FixedPointTap> taps;
+  for (size_t x = 0; x < kernel.rows; ++x) {
+    for (size_t y = 0; y < kernel.cols; ++y) {
+      if (kernel.weights[x * kernel.cols + y] != 0) {
+        taps.push_back(FixedPointTap{ x, y, kernel.weights[x * kernel.cols + y] });
+      }
+    }
+  }
+  // The row primitive takes the taps by pairs
+  if (taps.size() % 2 == 1) {
+    taps.push_back(FixedPointTap{ taps.back().row, taps.back().col, 0 });
+  }
+  std::vector<int16_t> weights;
+  for (const FixedPointTap& tap : taps) {
+    weights.push_back(tap.weight);
+  }
+
+  size_t cols = input_img.get_cols() / channels;
+  InteriorRange interior_rows = interior_range(input_img.get_rows(), kernel.rows);
+  InteriorRange interior_cols = interior_range(cols, kernel.cols);
+  size_t kernel_semi_rows = (kernel.rows - 1) / 2;
+  size_t kernel_semi_cols = (kernel.cols - 1) / 2;
+  auto correlate_border_pixel = [&](size_t row, size_t col, uint8_t* output_px) {
+    int32_t acc[4] = { 0, 0, 0, 0 };
+    for (const FixedPointTap& tap : taps) {
+      int row_index = border_index(int(row + tap.row) - int(kernel_semi_rows), input_img.get_rows(), border_mode);
+      int col_index = border_index(int(col + tap.col) - int(kernel_semi_cols), cols, border_mode);
+      if (row_index >= 0 && col_index >= 0) {
+        const uint8_t* input_px = input_img.row_ptr(row_index) + col_index * channels;
+        for (size_t channel = 0; channel < channels; ++channel) {
+          acc[channel] += int32_t(input_px[channel]) * tap.weight;
+        }
       }
-      ++acc_cpt;
-      acc += input_img->operator()(row_index, col_index) * kernel->operator()(x, y);
     }
+    for (size_t channel = 0; channel < channels; ++channel) {
+      output_px[channel] = uint8_t(std::min(uint32_t(std::abs(acc[channel])) >> kernel.shift, 255u));
+    }
+  };
+
+  size_t interior_size = (interior_cols.end - interior_cols.begin) * channels;
+  utils::parallel_for(input_img.get_rows(), [&](size_t row_begin, size_t row_end) {
+    std::vector<const uint8_t*> inputs(taps.size());
+    for (size_t row = row_begin; row < row_end; ++row) {
+      uint8_t* output_row = output_img.row_ptr(row);
+      bool interior_row = row >= interior_rows.begin && row < interior_rows.end && interior_size > 0;
+      size_t interior_begin = interior_row ? interior_cols.begin : cols;
+      size_t interior_end = interior_row ? interior_cols.end : cols;
+      for (size_t col = 0; col < interior_begin; ++col) {
+        correlate_border_pixel(row, col, output_row + col * channels);
+      }
+      if (interior_row) {
+        for (size_t i = 0; i < taps.size(); ++i) {
+          const uint8_t* input_row = input_img.row_ptr(row + taps[i].row - kernel_semi_rows);
+          inputs[i] = input_row + (interior_begin + taps[i].col - kernel_semi_cols) * channels;
+        }
+        simd::correlate_fixed_point_row(inputs.data(),
+                                        weights.data(),
+                                        taps.size(),
+                                        kernel.shift,
+                                        output_row + interior_begin * channels,
+                                        interior_size);
+      }
+      for (size_t col = interior_end; col < cols; ++col) {
+        correlate_border_pixel(row, col, output_row + col * channels);
+      }
+      finish_row(row);
+    }
+  });
+}
+
+// The direct fixed point correlation runs the 2D taps by pairs, at twice the float width. On gray images, the two 1D
+// float passes of rank-1 kernels are still cheaper from 5x5 up (as for the fixed size kernels). Packed RGBA float
+// passes unpack every channel, the fixed point path stays faster for them
+bool use_fixed_point(const Matrix<float>& kernel, bool keep_separable, FixedPointKernel& fixed_point_kernel)
+{
+  if (kernel.get_rows() * kernel.get_cols() >= FFT_KERNEL_AREA_THRESHOLD) {
+    return false;
+  }
+  SeparableKernel separable_kernel;
+  if (keep_separable && kernel.get_rows() >= 5 && kernel.get_cols() >= 5 &&
+      decompose_separable_kernel(kernel, separable_kernel)) {
+    return false;
   }
-  return float(std::sqrt(std::pow(acc, 2.f)));
+  return quantize_kernel(kernel, fixed_point_kernel);
+}
+}
+
+void apply_kernel_fixed_point(std::shared_ptr<Matrix<uint8_t>> input_img,
+                              std::shared_ptr<Matrix<float>> kernel,
+                              std::shared_ptr<Matrix<uint8_t>> output_img,
+                              BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<uint8_t>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  apply_kernel_fixed_point(input_img->view(), *kernel, output_img->view(), border_mode);
+}
+
+void apply_kernel_fixed_point(MatrixView<const uint8_t> input_img,
+                              const Matrix<float>& kernel,
+                              MatrixView<uint8_t> output_img,
+                              BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+
+  FixedPointKernel fixed_point_kernel;
+  if (!use_fixed_point(kernel, true, fixed_point_kernel)) {
+    apply_kernel<uint8_t, uint8_t>(input_img, kernel, output_img, border_mode);
+    return;
+  }
+  correlate_image_fixed_point(input_img, 1, fixed_point_kernel, output_img, border_mode, [](size_t) {});
+}
+
+void apply_kernel_fixed_point(std::shared_ptr<Matrix<uint32_t>> input_img,
+                              std::shared_ptr<Matrix<float>> kernel,
+                              std::shared_ptr<Matrix<uint32_t>> output_img,
+                              BorderMode border_mode)
+{
+  if (input_img->get_rows() != output_img->get_rows() || input_img->get_cols() != output_img->get_cols()) {
+    *output_img = Matrix<uint32_t>(input_img->get_rows(), input_img->get_cols());
+  }
+
+  apply_kernel_fixed_point(input_img->view(), *kernel, output_img->view(), border_mode);
+}
+
+void apply_kernel_fixed_point(MatrixView<const uint32_t> input_img,
+                              const Matrix<float>& kernel,
+                              MatrixView<uint32_t> output_img,
+                              BorderMode border_mode)
+{
+  assert(input_img.get_rows() == output_img.get_rows() && input_img.get_cols() == output_img.get_cols());
+
+  // Pixels are filtered as 4 interleaved bytes, alpha included, then alpha is overwritten. The byte of each channel
+  // depends on the endianness, only little endian hosts take this path
+  FixedPointKernel fixed_point_kernel;
+  if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__ || !use_fixed_point(kernel, false, fixed_point_kernel)) {
+    apply_kernel(input_img, kernel, output_img, border_mode);
+    return;
+  }
+  MatrixView<const uint8_t> input_bytes(reinterpret_cast<const uint8_t*>(input_img.data()),
+                                        input_img.get_rows(),
+                                        4 * input_img.get_cols(),
+                                        4 * input_img.get_stride());
+  MatrixView<uint8_t> output_bytes(reinterpret_cast<uint8_t*>(output_img.data()),
+                                   output_img.get_rows(),
+                                   4 * output_img.get_cols(),
+                                   4 * output_img.get_stride());
+  auto set_alpha = [&output_img](size_t row) {
+    RowSpan<uint32_t> output_row = output_img.row(row);
+    for (size_t col = 0; col < output_row.size(); ++col) {
+      output_row[col] |= 255;
+    }
+  };
+  correlate_image_fixed_point(input_bytes, 4, fixed_point_kernel, output_bytes, border_mode, set_alpha);
 }
 
 // Classic kernels
@@ -156,12 +1155,19 @@ std::shared_ptr<Matrix<float>> create_gaussian_kernel(int kernel_size, float sig
 {
   auto kernel = std::make_shared<Matrix<float>>(kernel_size, kernel_size);
   int kernel_semi_size = (kernel_size - 1) / 2;
+  float sum = 0.f;
   for (size_t row = 0; row < size_t(kernel_size); ++row) {
     for (size_t col = 0; col < size_t(kernel_size); ++col) {
       float _row_value = std::pow(float(row) - kernel_semi_size, 2.f);
       float _col_value = std::pow(float(col) - kernel_semi_size, 2.f);
-      kernel->operator()(row, col) =
-        (1.f / (2.f * M_PI * sigma)) * std::exp(-(_row_value + _col_value) / (2.f * sigma * sigma));
+      kernel->operator()(row, col) = std::exp(-(_row_value + _col_value) / (2.f * sigma * sigma));
+      sum += kernel->operator()(row, col);
+    }
+  }
+  // Unit gain whatever the size, so the blur keeps the brightness (and matches recursive_gaussian_blur)
+  for (size_t row = 0; row < size_t(kernel_size); ++row) {
+    for (size_t col = 0; col < size_t(kernel_size); ++col) {
+      kernel->operator()(row, col) /= sum;
     }
   }
   return kernel;
@@ -169,39 +1175,11 @@ std::shared_ptr<Matrix<float>> create_gaussian_kernel(int kernel_size, float sig
 
 std::shared_ptr<Matrix<float>> create_sobel_h_kernel()
 {
-  auto sobel_h = std::make_shared<Matrix<float>>(3, 3);
-
-  sobel_h->operator()(0, 0) = -1.f;
-  sobel_h->operator()(0, 1) = -2.f;
-  sobel_h->operator()(0, 2) = -1.f;
-
-  sobel_h->operator()(1, 0) = 0.f;
-  sobel_h->operator()(1, 1) = 0.f;
-  sobel_h->operator()(1, 2) = 0.f;
-
-  sobel_h->operator()(2, 0) = 1.f;
-  sobel_h->operator()(2, 1) = 2.f;
-  sobel_h->operator()(2, 2) = 1.f;
-
-  return sobel_h;
+  return SOBEL_H_KERNEL.to_matrix();
 }
 
 std::shared_ptr<Matrix<float>> create_sobel_v_kernel()
 {
-  auto sobel_v = std::make_shared<Matrix<float>>(3, 3);
-
-  sobel_v->operator()(0, 0) = -1.f;
-  sobel_v->operator()(0, 1) = 0.f;
-  sobel_v->operator()(0, 2) = 1.f;
-
-  sobel_v->operator()(1, 0) = -2.f;
-  sobel_v->operator()(1, 1) = 0.f;
-  sobel_v->operator()(1, 2) = 2.f;
-
-  sobel_v->operator()(2, 0) = -1.f;
-  sobel_v->operator()(2, 1) = 0.f;
-  sobel_v->operator()(2, 2) = 1.f;
-
-  return sobel_v;
+  return SOBEL_V_KERNEL.to_matrix();
 }
 }
\ No newline at end of file
@@ -0,0 +1,932 @@
+#include "image_processing/spatial_filtering_simd.h"
+
+#include "utils/cpu_features.h"
+#include "utils/pixel_traits.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CVUI_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// Contracting the multiplications and additions into FMAs would change the rounding between the paths
+#pragma GCC optimize("fp-contract=off")
+
+namespace ip {
+namespace simd {
+namespace {
+// ------------------------------------------------------------------------------------------------
+//                                     SCALAR
+// ------------------------------------------------------------------------------------------------
+namespace scalar {
+template<typename T>
+void accumulate_row(const T* input, float weight, float* acc, size_t size)
+{
+  for (size_t i = 0; i < size; ++i) {
+    acc[i] += input[i] * weight;
+  }
+}
+
+void accumulate_rgba_row(const uint32_t* input, float weight, float* r_acc, float* g_acc, float* b_acc, size_t size)
+{
+  for (size_t i = 0; i < size; ++i) {
+    r_acc[i] += ((input[i] & 0xff000000) >> 24) * weight;
+    g_acc[i] += ((input[i] & 0x00ff0000) >> 16) * weight;
+    b_acc[i] += ((input[i] & 0x0000ff00) >> 8) * weight;
+  }
+}
+
+template<typename T>
+void store_row(const float* acc, T* output, size_t size)
+{
+  for (size_t i = 0; i < size; ++i) {
+    output[i] = PixelTraits<T>::saturate(std::abs(acc[i]));
+  }
+}
+
+void store_rgba_row(const float* r_acc, const float* g_acc, const float* b_acc, uint32_t* output, size_t size)
+{
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t r = PixelTraits<uint8_t>::saturate(std::abs(r_acc[i]));
+    uint8_t g = PixelTraits<uint8_t>::saturate(std::abs(g_acc[i]));
+    uint8_t b = PixelTraits<uint8_t>::saturate(std::abs(b_acc[i]));
+    output[i] = uint32_t(r << 24 | g << 16 | b << 8 | 255);
+  }
+}
+
+// Fixed point rows work on [begin, size) as well
+void correlate_fixed_point_row(const uint8_t* const* inputs,
+                               const int16_t* weights,
+                               size_t taps,
+                               int shift,
+                               uint8_t* output,
+                               size_t begin,
+                               size_t size)
+{
+  for (size_t i = begin; i < size; ++i) {
+    int32_t acc = 0;
+    for (size_t tap = 0; tap < taps; ++tap) {
+      acc += int32_t(inputs[tap][i]) * weights[tap];
+    }
+    output[i] = uint8_t(std::min(uint32_t(std::abs(acc)) >> shift, 255u));
+  }
+}
+
+void correlate_fixed_point_row(const uint8_t* const* inputs,
+                               const int16_t* weights,
+                               size_t taps,
+                               int shift,
+                               uint8_t* output,
+                               size_t size)
+{
+  correlate_fixed_point_row(inputs, weights, taps, shift, output, 0, size);
+}
+
+// Fixed kernels work on [begin, size), so that the vector versions can finish their rows with it
+template<size_t N, size_t M, typename T>
+void correlate_row(const T* const* input_rows, const float (&kernel)[N][M], float* acc, size_t begin, size_t size)
+{
+  for (size_t i = begin; i < size; ++i) {
+    float sum = 0.f;
+    for (size_t x = 0; x < N; ++x) {
+      for (size_t y = 0; y < M; ++y) {
+        sum += input_rows[x][i + y] * kernel[x][y];
+      }
+    }
+    acc[i] = sum;
+  }
+}
+
+template<size_t N, size_t M>
+void correlate_rgba_row(const uint32_t* const* input_rows,
+                        const float (&kernel)[N][M],
+                        float* r_acc,
+                        float* g_acc,
+                        float* b_acc,
+                        size_t begin,
+                        size_t size)
+{
+  for (size_t i = begin; i < size; ++i) {
+    float r_sum = 0.f, g_sum = 0.f, b_sum = 0.f;
+    for (size_t x = 0; x < N; ++x) {
+      for (size_t y = 0; y < M; ++y) {
+        uint32_t pixel = input_rows[x][i + y];
+        r_sum += ((pixel & 0xff000000) >> 24) * kernel[x][y];
+        g_sum += ((pixel & 0x00ff0000) >> 16) * kernel[x][y];
+        b_sum += ((pixel & 0x0000ff00) >> 8) * kernel[x][y];
+      }
+    }
+    r_acc[i] = r_sum;
+    g_acc[i] = g_sum;
+    b_acc[i] = b_sum;
+  }
+}
+
+template<size_t N, size_t M, typename T>
+void correlate_row(const T* const* input_rows, const float (&kernel)[N][M], float* acc, size_t size)
+{
+  correlate_row(input_rows, kernel, acc, 0, size);
+}
+
+template<size_t N, size_t M>
+void correlate_rgba_row(const uint32_t* const* input_rows,
+                        const float (&kernel)[N][M],
+                        float* r_acc,
+                        float* g_acc,
+                        float* b_acc,
+                        size_t size)
+{
+  correlate_rgba_row(input_rows, kernel, r_acc, g_acc, b_acc, 0, size);
+}
+}
+
+#ifdef CVUI_X86_SIMD
+// Every vector loop ends with the scalar version on the last (size % width) pixels
+
+// ------------------------------------------------------------------------------------------------
+//                                     SSE4.1
+// ------------------------------------------------------------------------------------------------
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+namespace sse41 {
+const size_t WIDTH = 4;
+
+__m128 load(const uint8_t* input)
+{
+  int32_t bytes;
+  std::memcpy(&bytes, input, sizeof(bytes));
+  return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes)));
+}
+__m128 load(const uint16_t* input)
+{
+  return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(input))));
+}
+__m128 load(const float* input)
+{
+  return _mm_loadu_ps(input);
+}
+
+// |acc| clamped to [0, max_value] and truncated
+__m128i saturate(const float* acc, float max_value)
+{
+  __m128 value = _mm_andnot_ps(_mm_set1_ps(-0.f), _mm_loadu_ps(acc));
+  return _mm_cvttps_epi32(_mm_min_ps(value, _mm_set1_ps(max_value)));
+}
+
+template<typename T>
+void accumulate_row(const T* input, float weight, float* acc, size_t size)
+{
+  const __m128 weights = _mm_set1_ps(weight);
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(load(input + i), weights)));
+  }
+  scalar::accumulate_row(input + i, weight, acc + i, size - i);
+}
+
+void accumulate_rgba_row(const uint32_t* input, float weight, float* r_acc, float* g_acc, float* b_acc, size_t size)
+{
+  const __m128 weights = _mm_set1_ps(weight);
+  const __m128i mask = _mm_set1_epi32(0xff);
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+    __m128 r = _mm_cvtepi32_ps(_mm_srli_epi32(pixels, 24));
+    __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 16), mask));
+    __m128 b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 8), mask));
+    _mm_storeu_ps(r_acc + i, _mm_add_ps(_mm_loadu_ps(r_acc + i), _mm_mul_ps(r, weights)));
+    _mm_storeu_ps(g_acc + i, _mm_add_ps(_mm_loadu_ps(g_acc + i), _mm_mul_ps(g, weights)));
+    _mm_storeu_ps(b_acc + i, _mm_add_ps(_mm_loadu_ps(b_acc + i), _mm_mul_ps(b, weights)));
+  }
+  scalar::accumulate_rgba_row(input + i, weight, r_acc + i, g_acc + i, b_acc + i, size - i);
+}
+
+void store_row(const float* acc, uint8_t* output, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m128i words = _mm_packus_epi32(saturate(acc + i, PixelTraits<uint8_t>::max_value), _mm_setzero_si128());
+    int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+    std::memcpy(output + i, &bytes, sizeof(bytes));
+  }
+  scalar::store_row(acc + i, output + i, size - i);
+}
+
+void store_row(const float* acc, uint16_t* output, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m128i words = _mm_packus_epi32(saturate(acc + i, PixelTraits<uint16_t>::max_value), _mm_setzero_si128());
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), words);
+  }
+  scalar::store_row(acc + i, output + i, size - i);
+}
+
+void store_row(const float* acc, float* output, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    _mm_storeu_ps(output + i, _mm_andnot_ps(_mm_set1_ps(-0.f), _mm_loadu_ps(acc + i)));
+  }
+  scalar::store_row(acc + i, output + i, size - i);
+}
+
+void store_rgba_row(const float* r_acc, const float* g_acc, const float* b_acc, uint32_t* output, size_t size)
+{
+  const float max_value = PixelTraits<uint8_t>::max_value;
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m128i pixels = _mm_or_si128(_mm_slli_epi32(saturate(r_acc + i, max_value), 24),
+                                  _mm_slli_epi32(saturate(g_acc + i, max_value), 16));
+    pixels = _mm_or_si128(pixels, _mm_slli_epi32(saturate(b_acc + i, max_value), 8));
+    pixels = _mm_or_si128(pixels, _mm_set1_epi32(0xff));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), pixels);
+  }
+  scalar::store_rgba_row(r_acc + i, g_acc + i, b_acc + i, output + i, size - i);
+}
+
+// Loops with constant trip counts, fully unrolled by the compiler
+template<size_t N, size_t M, typename T>
+void correlate_row(const T* const* input_rows, const float (&kernel)[N][M], float* acc, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m128 sum = _mm_setzero_ps();
+    for (size_t x = 0; x < N; ++x) {
+      for (size_t y = 0; y < M; ++y) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(load(input_rows[x] + i + y), _mm_set1_ps(kernel[x][y])));
+      }
+    }
+    _mm_storeu_ps(acc + i, sum);
+  }
+  scalar::correlate_row(input_rows, kernel, acc, i, size);
+}
+
+template<size_t N, size_t M>
+void correlate_rgba_row(const uint32_t* const* input_rows,
+                        const float (&kernel)[N][M],
+                        float* r_acc,
+                        float* g_acc,
+                        float* b_acc,
+                        size_t size)
+{
+  const __m128i mask = _mm_set1_epi32(0xff);
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m128 r_sum = _mm_setzero_ps(), g_sum = _mm_setzero_ps(), b_sum = _mm_setzero_ps();
+    for (size_t x = 0; x < N; ++x) {
+      for (size_t y = 0; y < M; ++y) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input_rows[x] + i + y));
+        __m128 weights = _mm_set1_ps(kernel[x][y]);
+        __m128 r = _mm_cvtepi32_ps(_mm_srli_epi32(pixels, 24));
+        __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 16), mask));
+        __m128 b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 8), mask));
+        r_sum = _mm_add_ps(r_sum, _mm_mul_ps(r, weights));
+        g_sum = _mm_add_ps(g_sum, _mm_mul_ps(g, weights));
+        b_sum = _mm_add_ps(b_sum, _mm_mul_ps(b, weights));
+      }
+    }
+    _mm_storeu_ps(r_acc + i, r_sum);
+    _mm_storeu_ps(g_acc + i, g_sum);
+    _mm_storeu_ps(b_acc + i, b_sum);
+  }
+  scalar::correlate_rgba_row(input_rows, kernel, r_acc, g_acc, b_acc, i, size);
+}
+
+// Words (weights[tap], weights[tap + 1]) repeated, for the multiply-adds of the interleaved bytes of two taps
+__m128i weight_pair(const int16_t* weights)
+{
+  return _mm_set1_epi32(int32_t(uint32_t(uint16_t(weights[1])) << 16 | uint16_t(weights[0])));
+}
+
+// |acc| >> shift, clamped to 255
+__m128i saturate_fixed_point(__m128i acc, __m128i shift)
+{
+  return _mm_min_epu32(_mm_srl_epi32(_mm_abs_epi32(acc), shift), _mm_set1_epi32(255));
+}
+
+void correlate_fixed_point_row(const uint8_t* const* inputs,
+                               const int16_t* weights,
+                               size_t taps,
+                               int shift,
+                               uint8_t* output,
+                               size_t size)
+{
+  const __m128i count = _mm_cvtsi32_si128(shift);
+  size_t i = 0;
+  for (; i + 2 * WIDTH <= size; i += 2 * WIDTH) {
+    __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+    for (size_t tap = 0; tap < taps; tap += 2) {
+      __m128i a = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(inputs[tap] + i));
+      __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(inputs[tap + 1] + i));
+      __m128i pairs = _mm_unpacklo_epi8(a, b);
+      __m128i weight = weight_pair(weights + tap);
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_cvtepu8_epi16(pairs), weight));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(pairs, 8)), weight));
+    }
+    __m128i words = _mm_packus_epi32(saturate_fixed_point(lo, count), saturate_fixed_point(hi, count));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(words, words));
+  }
+  scalar::correlate_fixed_point_row(inputs, weights, taps, shift, output, i, size);
+}
+}
+#pragma GCC pop_options
+
+// ------------------------------------------------------------------------------------------------
+//                                     AVX2
+// ------------------------------------------------------------------------------------------------
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace avx2 {
+const size_t WIDTH = 8;
+
+__m256 load(const uint8_t* input)
+{
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(input))));
+}
+__m256 load(const uint16_t* input)
+{
+  return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input))));
+}
+__m256 load(const float* input)
+{
+  return _mm256_loadu_ps(input);
+}
+
+__m256i saturate(const float* acc, float max_value)
+{
+  __m256 value = _mm256_andnot_ps(_mm256_set1_ps(-0.f), _mm256_loadu_ps(acc));
+  return _mm256_cvttps_epi32(_mm256_min_ps(value, _mm256_set1_ps(max_value)));
+}
+
+// 8 x 32 bits to 8 x 16 bits, packus works within 128 bits lanes
+__m128i pack_words(__m256i values)
+{
+  return _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+}
+
+template<typename T>
+void accumulate_row(const T* input, float weight, float* acc, size_t size)
+{
+  const __m256 weights = _mm256_set1_ps(weight);
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(load(input + i), weights)));
+  }
+  scalar::accumulate_row(input + i, weight, acc + i, size - i);
+}
+
+void accumulate_rgba_row(const uint32_t* input, float weight, float* r_acc, float* g_acc, float* b_acc, size_t size)
+{
+  const __m256 weights = _mm256_set1_ps(weight);
+  const __m256i mask = _mm256_set1_epi32(0xff);
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+    __m256 r = _mm256_cvtepi32_ps(_mm256_srli_epi32(pixels, 24));
+    __m256 g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask));
+    __m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask));
+    _mm256_storeu_ps(r_acc + i, _mm256_add_ps(_mm256_loadu_ps(r_acc + i), _mm256_mul_ps(r, weights)));
+    _mm256_storeu_ps(g_acc + i, _mm256_add_ps(_mm256_loadu_ps(g_acc + i), _mm256_mul_ps(g, weights)));
+    _mm256_storeu_ps(b_acc + i, _mm256_add_ps(_mm256_loadu_ps(b_acc + i), _mm256_mul_ps(b, weights)));
+  }
+  scalar::accumulate_rgba_row(input + i, weight, r_acc + i, g_acc + i, b_acc + i, size - i);
+}
+
+void store_row(const float* acc, uint8_t* output, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m128i words = pack_words(saturate(acc + i, PixelTraits<uint8_t>::max_value));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(words, words));
+  }
+  scalar::store_row(acc + i, output + i, size - i);
+}
+
+void store_row(const float* acc, uint16_t* output, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m128i words = pack_words(saturate(acc + i, PixelTraits<uint16_t>::max_value));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), words);
+  }
+  scalar::store_row(acc + i, output + i, size - i);
+}
+
+void store_row(const float* acc, float* output, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    _mm256_storeu_ps(output + i, _mm256_andnot_ps(_mm256_set1_ps(-0.f), _mm256_loadu_ps(acc + i)));
+  }
+  scalar::store_row(acc + i, output + i, size - i);
+}
+
+void store_rgba_row(const float* r_acc, const float* g_acc, const float* b_acc, uint32_t* output, size_t size)
+{
+  const float max_value = PixelTraits<uint8_t>::max_value;
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m256i pixels = _mm256_or_si256(_mm256_slli_epi32(saturate(r_acc + i, max_value), 24),
+                                     _mm256_slli_epi32(saturate(g_acc + i, max_value), 16));
+    pixels = _mm256_or_si256(pixels, _mm256_slli_epi32(saturate(b_acc + i, max_value), 8));
+    pixels = _mm256_or_si256(pixels, _mm256_set1_epi32(0xff));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), pixels);
+  }
+  scalar::store_rgba_row(r_acc + i, g_acc + i, b_acc + i, output + i, size - i);
+}
+
+// Loops with constant trip counts, fully unrolled by the compiler
+template<size_t N, size_t M, typename T>
+void correlate_row(const T* const* input_rows, const float (&kernel)[N][M], float* acc, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t x = 0; x < N; ++x) {
+      for (size_t y = 0; y < M; ++y) {
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(load(input_rows[x] + i + y), _mm256_set1_ps(kernel[x][y])));
+      }
+    }
+    _mm256_storeu_ps(acc + i, sum);
+  }
+  scalar::correlate_row(input_rows, kernel, acc, i, size);
+}
+
+template<size_t N, size_t M>
+void correlate_rgba_row(const uint32_t* const* input_rows,
+                        const float (&kernel)[N][M],
+                        float* r_acc,
+                        float* g_acc,
+                        float* b_acc,
+                        size_t size)
+{
+  const __m256i mask = _mm256_set1_epi32(0xff);
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m256 r_sum = _mm256_setzero_ps(), g_sum = _mm256_setzero_ps(), b_sum = _mm256_setzero_ps();
+    for (size_t x = 0; x < N; ++x) {
+      for (size_t y = 0; y < M; ++y) {
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input_rows[x] + i + y));
+        __m256 weights = _mm256_set1_ps(kernel[x][y]);
+        __m256 r = _mm256_cvtepi32_ps(_mm256_srli_epi32(pixels, 24));
+        __m256 g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask));
+        __m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask));
+        r_sum = _mm256_add_ps(r_sum, _mm256_mul_ps(r, weights));
+        g_sum = _mm256_add_ps(g_sum, _mm256_mul_ps(g, weights));
+        b_sum = _mm256_add_ps(b_sum, _mm256_mul_ps(b, weights));
+      }
+    }
+    _mm256_storeu_ps(r_acc + i, r_sum);
+    _mm256_storeu_ps(g_acc + i, g_sum);
+    _mm256_storeu_ps(b_acc + i, b_sum);
+  }
+  scalar::correlate_rgba_row(input_rows, kernel, r_acc, g_acc, b_acc, i, size);
+}
+
+__m256i weight_pair(const int16_t* weights)
+{
+  return _mm256_set1_epi32(int32_t(uint32_t(uint16_t(weights[1])) << 16 | uint16_t(weights[0])));
+}
+
+__m256i saturate_fixed_point(__m256i acc, __m128i shift)
+{
+  return _mm256_min_epu32(_mm256_srl_epi32(_mm256_abs_epi32(acc), shift), _mm256_set1_epi32(255));
+}
+
+// Bytes are interleaved within 128 bits, before the widening, so that the sums come out in pixel order
+void correlate_fixed_point_row(const uint8_t* const* inputs,
+                               const int16_t* weights,
+                               size_t taps,
+                               int shift,
+                               uint8_t* output,
+                               size_t size)
+{
+  const __m128i count = _mm_cvtsi32_si128(shift);
+  size_t i = 0;
+  for (; i + 2 * WIDTH <= size; i += 2 * WIDTH) {
+    __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+    for (size_t tap = 0; tap < taps; tap += 2) {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs[tap] + i));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs[tap + 1] + i));
+      __m256i weight = weight_pair(weights + tap);
+      lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(a, b)), weight));
+      hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpackhi_epi8(a, b)), weight));
+    }
+    __m128i lo_words = pack_words(saturate_fixed_point(lo, count));
+    __m128i hi_words = pack_words(saturate_fixed_point(hi, count));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(lo_words, hi_words));
+  }
+  scalar::correlate_fixed_point_row(inputs, weights, taps, shift, output, i, size);
+}
+}
+#pragma GCC pop_options
+
+// ------------------------------------------------------------------------------------------------
+//                                     AVX-512
+// ------------------------------------------------------------------------------------------------
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw")
+// GCC 12 reports the self-initialized _mm512_undefined_* of its own headers
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+namespace avx512 {
+const size_t WIDTH = 16;
+
+__m512 load(const uint8_t* input)
+{
+  return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input))));
+}
+__m512 load(const uint16_t* input)
+{
+  return _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input))));
+}
+__m512 load(const float* input)
+{
+  return _mm512_loadu_ps(input);
+}
+
+// Values are in [0, max_value] once saturated, the unsigned narrowing conversions never clamp
+__m512i saturate(const float* acc, float max_value)
+{
+  return _mm512_cvttps_epi32(_mm512_min_ps(_mm512_abs_ps(_mm512_loadu_ps(acc)), _mm512_set1_ps(max_value)));
+}
+
+template<typename T>
+void accumulate_row(const T* input, float weight, float* acc, size_t size)
+{
+  const __m512 weights = _mm512_set1_ps(weight);
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    _mm512_storeu_ps(acc + i, _mm512_add_ps(_mm512_loadu_ps(acc + i), _mm512_mul_ps(load(input + i), weights)));
+  }
+  scalar::accumulate_row(input + i, weight, acc + i, size - i);
+}
+
+void accumulate_rgba_row(const uint32_t* input, float weight, float* r_acc, float* g_acc, float* b_acc, size_t size)
+{
+  const __m512 weights = _mm512_set1_ps(weight);
+  const __m512i mask = _mm512_set1_epi32(0xff);
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m512i pixels = _mm512_loadu_si512(input + i);
+    __m512 r = _mm512_cvtepi32_ps(_mm512_srli_epi32(pixels, 24));
+    __m512 g = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(pixels, 16), mask));
+    __m512 b = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(pixels, 8), mask));
+    _mm512_storeu_ps(r_acc + i, _mm512_add_ps(_mm512_loadu_ps(r_acc + i), _mm512_mul_ps(r, weights)));
+    _mm512_storeu_ps(g_acc + i, _mm512_add_ps(_mm512_loadu_ps(g_acc + i), _mm512_mul_ps(g, weights)));
+    _mm512_storeu_ps(b_acc + i, _mm512_add_ps(_mm512_loadu_ps(b_acc + i), _mm512_mul_ps(b, weights)));
+  }
+  scalar::accumulate_rgba_row(input + i, weight, r_acc + i, g_acc + i, b_acc + i, size - i);
+}
+
+void store_row(const float* acc, uint8_t* output, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m128i bytes = _mm512_cvtusepi32_epi8(saturate(acc + i, PixelTraits<uint8_t>::max_value));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), bytes);
+  }
+  scalar::store_row(acc + i, output + i, size - i);
+}
+
+void store_row(const float* acc, uint16_t* output, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m256i words = _mm512_cvtusepi32_epi16(saturate(acc + i, PixelTraits<uint16_t>::max_value));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), words);
+  }
+  scalar::store_row(acc + i, output + i, size - i);
+}
+
+void store_row(const float* acc, float* output, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    _mm512_storeu_ps(output + i, _mm512_abs_ps(_mm512_loadu_ps(acc + i)));
+  }
+  scalar::store_row(acc + i, output + i, size - i);
+}
+
+void store_rgba_row(const float* r_acc, const float* g_acc, const float* b_acc, uint32_t* output, size_t size)
+{
+  const float max_value = PixelTraits<uint8_t>::max_value;
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m512i pixels = _mm512_or_si512(_mm512_slli_epi32(saturate(r_acc + i, max_value), 24),
+                                     _mm512_slli_epi32(saturate(g_acc + i, max_value), 16));
+    pixels = _mm512_or_si512(pixels, _mm512_slli_epi32(saturate(b_acc + i, max_value), 8));
+    pixels = _mm512_or_si512(pixels, _mm512_set1_epi32(0xff));
+    _mm512_storeu_si512(output + i, pixels);
+  }
+  scalar::store_rgba_row(r_acc + i, g_acc + i, b_acc + i, output + i, size - i);
+}
+
+// Loops with constant trip counts, fully unrolled by the compiler
+template<size_t N, size_t M, typename T>
+void correlate_row(const T* const* input_rows, const float (&kernel)[N][M], float* acc, size_t size)
+{
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t x = 0; x < N; ++x) {
+      for (size_t y = 0; y < M; ++y) {
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(load(input_rows[x] + i + y), _mm512_set1_ps(kernel[x][y])));
+      }
+    }
+    _mm512_storeu_ps(acc + i, sum);
+  }
+  scalar::correlate_row(input_rows, kernel, acc, i, size);
+}
+
+template<size_t N, size_t M>
+void correlate_rgba_row(const uint32_t* const* input_rows,
+                        const float (&kernel)[N][M],
+                        float* r_acc,
+                        float* g_acc,
+                        float* b_acc,
+                        size_t size)
+{
+  const __m512i mask = _mm512_set1_epi32(0xff);
+  size_t i = 0;
+  for (; i + WIDTH <= size; i += WIDTH) {
+    __m512 r_sum = _mm512_setzero_ps(), g_sum = _mm512_setzero_ps(), b_sum = _mm512_setzero_ps();
+    for (size_t x = 0; x < N; ++x) {
+      for (size_t y = 0; y < M; ++y) {
+        __m512i pixels = _mm512_loadu_si512(input_rows[x] + i + y);
+        __m512 weights = _mm512_set1_ps(kernel[x][y]);
+        __m512 r = _mm512_cvtepi32_ps(_mm512_srli_epi32(pixels, 24));
+        __m512 g = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(pixels, 16), mask));
+        __m512 b = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(pixels, 8), mask));
+        r_sum = _mm512_add_ps(r_sum, _mm512_mul_ps(r, weights));
+        g_sum = _mm512_add_ps(g_sum, _mm512_mul_ps(g, weights));
+        b_sum = _mm512_add_ps(b_sum, _mm512_mul_ps(b, weights));
+      }
+    }
+    _mm512_storeu_ps(r_acc + i, r_sum);
+    _mm512_storeu_ps(g_acc + i, g_sum);
+    _mm512_storeu_ps(b_acc + i, b_sum);
+  }
+  scalar::correlate_rgba_row(input_rows, kernel, r_acc, g_acc, b_acc, i, size);
+}
+
+__m512i weight_pair(const int16_t* weights)
+{
+  return _mm512_set1_epi32(int32_t(uint32_t(uint16_t(weights[1])) << 16 | uint16_t(weights[0])));
+}
+
+// Each 128 bits half of the interleaved bytes widens to 16 words, two multiply-adds give 32 sums in pixel order
+void correlate_fixed_point_row(const uint8_t* const* inputs,
+                               const int16_t* weights,
+                               size_t taps,
+                               int shift,
+                               uint8_t* output,
+                               size_t size)
+{
+  const __m128i count = _mm_cvtsi32_si128(shift);
+  // The unsigned narrowing saturates to 255
+  size_t i = 0;
+  for (; i + 2 * WIDTH <= size; i += 2 * WIDTH) {
+    __m512i lo = _mm512_setzero_si512(), hi = _mm512_setzero_si512();
+    for (size_t tap = 0; tap < taps; tap += 2) {
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs[tap] + i));
+      __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs[tap + 1] + i));
+      __m256i lo_pairs = _mm256_permute2x128_si256(_mm256_unpacklo_epi8(a, b), _mm256_unpackhi_epi8(a, b), 0x20);
+      __m256i hi_pairs = _mm256_permute2x128_si256(_mm256_unpacklo_epi8(a, b), _mm256_unpackhi_epi8(a, b), 0x31);
+      __m512i weight = weight_pair(weights + tap);
+      lo = _mm512_add_epi32(lo, _mm512_madd_epi16(_mm512_cvtepu8_epi16(lo_pairs), weight));
+      hi = _mm512_add_epi32(hi, _mm512_madd_epi16(_mm512_cvtepu8_epi16(hi_pairs), weight));
+    }
+    __m128i lo_bytes = _mm512_cvtusepi32_epi8(_mm512_srl_epi32(_mm512_abs_epi32(lo), count));
+    __m128i hi_bytes = _mm512_cvtusepi32_epi8(_mm512_srl_epi32(_mm512_abs_epi32(hi), count));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), lo_bytes);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + WIDTH), hi_bytes);
+  }
+  scalar::correlate_fixed_point_row(inputs, weights, taps, shift, output, i, size);
+}
+}
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+// ------------------------------------------------------------------------------------------------
+//                                     DISPATCH
+// ------------------------------------------------------------------------------------------------
+// Row primitives of a pixel format, selected once from the SIMD level of the host
+template<typename T>
+struct RowKernels
+{
+  void (*accumulate)(const T*, float, float*, size_t);
+  void (*store)(const float*, T*, size_t);
+};
+
+struct RgbaRowKernels
+{
+  void (*accumulate)(const uint32_t*, float, float*, float*, float*, size_t);
+  void (*store)(const float*, const float*, const float*, uint32_t*, size_t);
+};
+
+template<size_t N, size_t M, typename T>
+struct FixedRowKernels
+{
+  void (*correlate)(const T* const*, const float (&)[N][M], float*, size_t);
+};
+
+template<size_t N, size_t M>
+struct FixedRgbaRowKernels
+{
+  void (*correlate)(const uint32_t* const*, const float (&)[N][M], float*, float*, float*, size_t);
+};
+
+struct FixedPointRowKernels
+{
+  void (*correlate)(const uint8_t* const*, const int16_t*, size_t, int, uint8_t*, size_t);
+};
+
+template<typename T>
+RowKernels<T> select_row_kernels(utils::SimdLevel level)
+{
+  switch (level) {
+#ifdef CVUI_X86_SIMD
+    case utils::SimdLevel::AVX512:
+      return RowKernels<T>{ avx512::accumulate_row<T>, avx512::store_row };
+    case utils::SimdLevel::AVX2:
+      return RowKernels<T>{ avx2::accumulate_row<T>, avx2::store_row };
+    case utils::SimdLevel::SSE41:
+      return RowKernels<T>{ sse41::accumulate_row<T>, sse41::store_row };
+#endif
+    default:
+      return RowKernels<T>{ scalar::accumulate_row<T>, scalar::store_row<T> };
+  }
+}
+
+RgbaRowKernels select_rgba_row_kernels(utils::SimdLevel level)
+{
+  switch (level) {
+#ifdef CVUI_X86_SIMD
+    case utils::SimdLevel::AVX512:
+      return RgbaRowKernels{ avx512::accumulate_rgba_row, avx512::store_rgba_row };
+    case utils::SimdLevel::AVX2:
+      return RgbaRowKernels{ avx2::accumulate_rgba_row, avx2::store_rgba_row };
+    case utils::SimdLevel::SSE41:
+      return RgbaRowKernels{ sse41::accumulate_rgba_row, sse41::store_rgba_row };
+#endif
+    default:
+      return RgbaRowKernels{ scalar::accumulate_rgba_row, scalar::store_rgba_row };
+  }
+}
+
+FixedPointRowKernels select_fixed_point_row_kernels(utils::SimdLevel level)
+{
+  switch (level) {
+#ifdef CVUI_X86_SIMD
+    case utils::SimdLevel::AVX512:
+      return FixedPointRowKernels{ avx512::correlate_fixed_point_row };
+    case utils::SimdLevel::AVX2:
+      return FixedPointRowKernels{ avx2::correlate_fixed_point_row };
+    case utils::SimdLevel::SSE41:
+      return FixedPointRowKernels{ sse41::correlate_fixed_point_row };
+#endif
+    default:
+      return FixedPointRowKernels{ scalar::correlate_fixed_point_row };
+  }
+}
+
+template<size_t N, size_t M, typename T>
+FixedRowKernels<N, M, T> select_fixed_row_kernels(utils::SimdLevel level)
+{
+  switch (level) {
+#ifdef CVUI_X86_SIMD
+    case utils::SimdLevel::AVX512:
+      return FixedRowKernels<N, M, T>{ avx512::correlate_row<N, M, T> };
+    case utils::SimdLevel::AVX2:
+      return FixedRowKernels<N, M, T>{ avx2::correlate_row<N, M, T> };
+    case utils::SimdLevel::SSE41:
+      return FixedRowKernels<N, M, T>{ sse41::correlate_row<N, M, T> };
+#endif
+    default:
+      return FixedRowKernels<N, M, T>{ scalar::correlate_row<N, M, T> };
+  }
+}
+
+template<size_t N, size_t M>
+FixedRgbaRowKernels<N, M> select_fixed_rgba_row_kernels(utils::SimdLevel level)
+{
+  switch (level) {
+#ifdef CVUI_X86_SIMD
+    case utils::SimdLevel::AVX512:
+      return FixedRgbaRowKernels<N, M>{ avx512::correlate_rgba_row<N, M> };
+    case utils::SimdLevel::AVX2:
+      return FixedRgbaRowKernels<N, M>{ avx2::correlate_rgba_row<N, M> };
+    case utils::SimdLevel::SSE41:
+      return FixedRgbaRowKernels<N, M>{ sse41::correlate_rgba_row<N, M> };
+#endif
+    default:
+      return FixedRgbaRowKernels<N, M>{ scalar::correlate_rgba_row<N, M> };
+  }
+}
+
+template<typename T>
+const RowKernels<T>& get_row_kernels()
+{
+  static const RowKernels<T> kernels = select_row_kernels<T>(utils::get_simd_level());
+  return kernels;
+}
+
+const RgbaRowKernels& get_rgba_row_kernels()
+{
+  static const RgbaRowKernels kernels = select_rgba_row_kernels(utils::get_simd_level());
+  return kernels;
+}
+
+const FixedPointRowKernels& get_fixed_point_row_kernels()
+{
+  static const FixedPointRowKernels kernels = select_fixed_point_row_kernels(utils::get_simd_level());
+  return kernels;
+}
+
+template<size_t N, size_t M, typename T>
+const FixedRowKernels<N, M, T>& get_fixed_row_kernels()
+{
+  static const FixedRowKernels<N, M, T> kernels = select_fixed_row_kernels<N, M, T>(utils::get_simd_level());
+  return kernels;
+}
+
+template<size_t N, size_t M>
+const FixedRgbaRowKernels<N, M>& get_fixed_rgba_row_kernels()
+{
+  static const FixedRgbaRowKernels<N, M> kernels = select_fixed_rgba_row_kernels<N, M>(utils::get_simd_level());
+  return kernels;
+}
+}
+
+template<typename T>
+void accumulate_row(const T* input, float weight, float* acc, size_t size)
+{
+  get_row_kernels<T>().accumulate(input, weight, acc, size);
+}
+
+void accumulate_rgba_row(const uint32_t* input, float weight, float* r_acc, float* g_acc, float* b_acc, size_t size)
+{
+  get_rgba_row_kernels().accumulate(input, weight, r_acc, g_acc, b_acc, size);
+}
+
+template<typename T>
+void store_row(const float* acc, T* output, size_t size)
+{
+  get_row_kernels<T>().store(acc, output, size);
+}
+
+void store_rgba_row(const float* r_acc, const float* g_acc, const float* b_acc, uint32_t* output, size_t size)
+{
+  get_rgba_row_kernels().store(r_acc, g_acc, b_acc, output, size);
+}
+
+template<size_t N, size_t M, typename T>
+void correlate_row(const T* const* input_rows, const float (&kernel)[N][M], float* acc, size_t size)
+{
+  get_fixed_row_kernels<N, M, T>().correlate(input_rows, kernel, acc, size);
+}
+
+template<size_t N, size_t M>
+void correlate_rgba_row(const uint32_t* const* input_rows,
+                        const float (&kernel)[N][M],
+                        float* r_acc,
+                        float* g_acc,
+                        float* b_acc,
+                        size_t size)
+{
+  get_fixed_rgba_row_kernels<N, M>().correlate(input_rows, kernel, r_acc, g_acc, b_acc, size);
+}
+
+void correlate_fixed_point_row(const uint8_t* const* inputs,
+                               const int16_t* weights,
+                               size_t taps,
+                               int shift,
+                               uint8_t* output,
+                               size_t size)
+{
+  get_fixed_point_row_kernels().correlate(inputs, weights, taps, shift, output, size);
+}
+
+#define INSTANTIATE_ROW_KERNELS(T)                                                                                    \
+  template void accumulate_row<T>(const T*, float, float*, size_t);                                                   \
+  template void store_row<T>(const float*, T*, size_t);
+
+INSTANTIATE_ROW_KERNELS(uint8_t)
+INSTANTIATE_ROW_KERNELS(uint16_t)
+INSTANTIATE_ROW_KERNELS(float)
+
+#define INSTANTIATE_FIXED_ROW_KERNELS(N, M)                                                                           \
+  template void correlate_row<N, M, uint8_t>(const uint8_t* const*, const float(&)[N][M], float*, size_t);            \
+  template void correlate_row<N, M, uint16_t>(const uint16_t* const*, const float(&)[N][M], float*, size_t);          \
+  template void correlate_row<N, M, float>(const float* const*, const float(&)[N][M], float*, size_t);                \
+  template void correlate_rgba_row<N, M>(const uint32_t* const*, const float(&)[N][M], float*, float*, float*, size_t);
+
+INSTANTIATE_FIXED_ROW_KERNELS(3, 3)
+INSTANTIATE_FIXED_ROW_KERNELS(5, 5)
+}
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "image_processing/utils.h"
 
+#include "utils/parallel.h"
+
 // ------------------------------------------------------------------------------------------------
 //                                     RGBAPixel
 // ------------------------------------------------------------------------------------------------
@@ -122,75 +124,183 @@ void HSVAPixel::amplify_value(double factor)
 }
 
 namespace ip {
-std::shared_ptr<Matrix<uint8_t>> rgba_to_gray(std::shared_ptr<Matrix<uint32_t>> rgba_img)
+namespace {
+// Luma of 8 bit channels, in the range of the gray format
+template<typename T>
+T luma(uint8_t r, uint8_t g, uint8_t b)
 {
-  std::shared_ptr<Matrix<uint8_t>> gray_img =
-    std::make_shared<Matrix<uint8_t>>(rgba_img->get_rows(), rgba_img->get_cols());
+  float value = float(0.2989 * r + 0.5870 * g + 0.1140 * b);
+  return PixelTraits<T>::saturate(value * (PixelTraits<T>::max_value / PixelTraits<uint8_t>::max_value));
+}
+}
 
-  for (size_t i = 0; i < rgba_img->get_rows(); ++i) {
-    for (size_t j = 0; j < rgba_img->get_cols(); ++j) {
-      auto rgba_pixel = rgba_img->operator()(i, j);
-      gray_img->operator()(i, j) =
-        uint8_t(0.2989 * ((rgba_pixel & 0xff000000) >> 24) + 0.5870 * ((rgba_pixel & 0x00ff0000) >> 16) +
-                0.1140 * ((rgba_pixel & 0x0000ff00) >> 8));
-    }
-  }
+template<typename T>
+std::shared_ptr<Matrix<T>> rgba_to_gray(std::shared_ptr<Matrix<uint32_t>> rgba_img)
+{
+  auto gray_img = std::make_shared<Matrix<T>>(rgba_img->get_rows(), rgba_img->get_cols());
+  rgba_to_gray(rgba_img->view(), gray_img->view());
   return gray_img;
 }
-std::shared_ptr<Matrix<uint32_t>> gray_to_rgba(std::shared_ptr<Matrix<uint8_t>> gray_img)
+template<typename T>
+std::shared_ptr<Matrix<uint32_t>> gray_to_rgba(std::shared_ptr<Matrix<T>> gray_img)
 {
   auto rgba_img = std::make_shared<Matrix<uint32_t>>(gray_img->get_rows(), gray_img->get_cols());
-  for (size_t row = 0; row < gray_img->get_rows(); ++row) {
-    for (size_t col = 0; col < gray_img->get_cols(); ++col) {
-      uint8_t gray_value = gray_img->operator()(row, col);
-      RGBAPixel pix(gray_value, gray_value, gray_value);
-      rgba_img->operator()(row, col) = pix.to_uint32_t();
-    }
-  }
+  gray_to_rgba(MatrixView<const T>(gray_img->view()), rgba_img->view());
   return rgba_img;
 }
 
-std::shared_ptr<Matrix<uint32_t>> rgba_to_hsva(std::shared_ptr<Matrix<uint32_t>> rgba_img)
+template<typename T>
+void rgba_to_gray(MatrixView<const uint32_t> rgba_img, MatrixView<T> gray_img)
 {
-  auto hsva_img = std::make_shared<Matrix<uint32_t>>(rgba_img->get_rows(), rgba_img->get_cols());
+  utils::transform(rgba_img, gray_img, [](uint32_t rgba_pixel) {
+    return luma<T>(uint8_t(rgba_pixel >> 24), uint8_t(rgba_pixel >> 16), uint8_t(rgba_pixel >> 8));
+  });
+}
+template<typename T>
+void gray_to_rgba(MatrixView<const T> gray_img, MatrixView<uint32_t> rgba_img)
+{
+  utils::transform(gray_img, rgba_img, [](T gray_pixel) {
+    uint8_t gray_value = convert_pixel<uint8_t>(gray_pixel);
+    return RGBAPixel(gray_value, gray_value, gray_value).to_uint32_t();
+  });
+}
+
+template std::shared_ptr<Matrix<uint8_t>> rgba_to_gray<uint8_t>(std::shared_ptr<Matrix<uint32_t>>);
+template std::shared_ptr<Matrix<uint16_t>> rgba_to_gray<uint16_t>(std::shared_ptr<Matrix<uint32_t>>);
+template std::shared_ptr<Matrix<float>> rgba_to_gray<float>(std::shared_ptr<Matrix<uint32_t>>);
+template std::shared_ptr<Matrix<uint32_t>> gray_to_rgba<uint8_t>(std::shared_ptr<Matrix<uint8_t>>);
+template std::shared_ptr<Matrix<uint32_t>> gray_to_rgba<uint16_t>(std::shared_ptr<Matrix<uint16_t>>);
+template std::shared_ptr<Matrix<uint32_t>> gray_to_rgba<float>(std::shared_ptr<Matrix<float>>);
+template void rgba_to_gray<uint8_t>(MatrixView<const uint32_t>, MatrixView<uint8_t>);
+template void rgba_to_gray<uint16_t>(MatrixView<const uint32_t>, MatrixView<uint16_t>);
+template void rgba_to_gray<float>(MatrixView<const uint32_t>, MatrixView<float>);
+template void gray_to_rgba<uint8_t>(MatrixView<const uint8_t>, MatrixView<uint32_t>);
+template void gray_to_rgba<uint16_t>(MatrixView<const uint16_t>, MatrixView<uint32_t>);
+template void gray_to_rgba<float>(MatrixView<const float>, MatrixView<uint32_t>);
+
+template<typename To, typename From>
+std::shared_ptr<Matrix<To>> convert_pixel_format(std::shared_ptr<Matrix<From>> input_img)
+{
+  auto output_img = std::make_shared<Matrix<To>>(input_img->get_rows(), input_img->get_cols());
+  utils::transform(input_img->view(), output_img->view(), convert_pixel<To, From>);
+  return output_img;
+}
+
+template std::shared_ptr<Matrix<uint16_t>> convert_pixel_format<uint16_t, uint8_t>(std::shared_ptr<Matrix<uint8_t>>);
+template std::shared_ptr<Matrix<float>> convert_pixel_format<float, uint8_t>(std::shared_ptr<Matrix<uint8_t>>);
+template std::shared_ptr<Matrix<uint8_t>> convert_pixel_format<uint8_t, uint16_t>(std::shared_ptr<Matrix<uint16_t>>);
+template std::shared_ptr<Matrix<float>> convert_pixel_format<float, uint16_t>(std::shared_ptr<Matrix<uint16_t>>);
+template std::shared_ptr<Matrix<uint8_t>> convert_pixel_format<uint8_t, float>(std::shared_ptr<Matrix<float>>);
+template std::shared_ptr<Matrix<uint16_t>> convert_pixel_format<uint16_t, float>(std::shared_ptr<Matrix<float>>);
+
+std::shared_ptr<PlanarImage> rgba_to_planar(std::shared_ptr<Matrix<uint32_t>> rgba_img)
+{
+  auto planar_img = std::make_shared<PlanarImage>(rgba_img->get_rows(), rgba_img->get_cols());
   for (size_t row = 0; row < rgba_img->get_rows(); ++row) {
+    const uint32_t* rgba_row = rgba_img->row_ptr(row);
+    uint8_t* r_row = planar_img->plane(PlanarImage::R).row_ptr(row);
+    uint8_t* g_row = planar_img->plane(PlanarImage::G).row_ptr(row);
+    uint8_t* b_row = planar_img->plane(PlanarImage::B).row_ptr(row);
+    uint8_t* a_row = planar_img->plane(PlanarImage::A).row_ptr(row);
     for (size_t col = 0; col < rgba_img->get_cols(); ++col) {
-      HSVAPixel pix(RGBAPixel(rgba_img->operator()(row, col)));
-      hsva_img->operator()(row, col) = pix.to_uint32_t();
+      uint32_t rgba_pixel = rgba_row[col];
+      r_row[col] = uint8_t(rgba_pixel >> 24);
+      g_row[col] = uint8_t(rgba_pixel >> 16);
+      b_row[col] = uint8_t(rgba_pixel >> 8);
+      a_row[col] = uint8_t(rgba_pixel);
     }
   }
+  return planar_img;
+}
+
+std::shared_ptr<Matrix<uint32_t>> planar_to_rgba(std::shared_ptr<PlanarImage> planar_img)
+{
+  auto rgba_img = std::make_shared<Matrix<uint32_t>>(planar_img->get_rows(), planar_img->get_cols());
+  for (size_t row = 0; row < planar_img->get_rows(); ++row) {
+    uint32_t* rgba_row = rgba_img->row_ptr(row);
+    const uint8_t* r_row = planar_img->plane(PlanarImage::R).row_ptr(row);
+    const uint8_t* g_row = planar_img->plane(PlanarImage::G).row_ptr(row);
+    const uint8_t* b_row = planar_img->plane(PlanarImage::B).row_ptr(row);
+    const uint8_t* a_row = planar_img->plane(PlanarImage::A).row_ptr(row);
+    for (size_t col = 0; col < planar_img->get_cols(); ++col) {
+      rgba_row[col] = uint32_t(r_row[col]) << 24 | uint32_t(g_row[col]) << 16 | uint32_t(b_row[col]) << 8 | a_row[col];
+    }
+  }
+  return rgba_img;
+}
+
+template<typename T>
+std::shared_ptr<Matrix<T>> planar_to_gray(std::shared_ptr<PlanarImage> planar_img)
+{
+  auto gray_img = std::make_shared<Matrix<T>>(planar_img->get_rows(), planar_img->get_cols());
+  for (size_t row = 0; row < planar_img->get_rows(); ++row) {
+    T* gray_row = gray_img->row_ptr(row);
+    const uint8_t* r_row = planar_img->plane(PlanarImage::R).row_ptr(row);
+    const uint8_t* g_row = planar_img->plane(PlanarImage::G).row_ptr(row);
+    const uint8_t* b_row = planar_img->plane(PlanarImage::B).row_ptr(row);
+    for (size_t col = 0; col < planar_img->get_cols(); ++col) {
+      gray_row[col] = luma<T>(r_row[col], g_row[col], b_row[col]);
+    }
+  }
+  return gray_img;
+}
+
+template std::shared_ptr<Matrix<uint8_t>> planar_to_gray<uint8_t>(std::shared_ptr<PlanarImage>);
+template std::shared_ptr<Matrix<uint16_t>> planar_to_gray<uint16_t>(std::shared_ptr<PlanarImage>);
+template std::shared_ptr<Matrix<float>> planar_to_gray<float>(std::shared_ptr<PlanarImage>);
+
+std::shared_ptr<Matrix<uint32_t>> rgba_to_hsva(std::shared_ptr<Matrix<uint32_t>> rgba_img)
+{
+  auto hsva_img = std::make_shared<Matrix<uint32_t>>(rgba_img->get_rows(), rgba_img->get_cols());
+  rgba_to_hsva(rgba_img->view(), hsva_img->view());
   return hsva_img;
 }
 
 std::shared_ptr<Matrix<uint32_t>> hsva_to_rgba(std::shared_ptr<Matrix<uint32_t>> hsva_img)
 {
   auto rgba_img = std::make_shared<Matrix<uint32_t>>(hsva_img->get_rows(), hsva_img->get_cols());
-  for (size_t row = 0; row < hsva_img->get_rows(); ++row) {
-    for (size_t col = 0; col < hsva_img->get_cols(); ++col) {
-      HSVAPixel pix(hsva_img->operator()(row, col));
-      rgba_img->operator()(row, col) = pix.to_rgba_pixel().to_uint32_t();
-    }
-  }
+  hsva_to_rgba(hsva_img->view(), rgba_img->view());
   return rgba_img;
 }
 
+void rgba_to_hsva(MatrixView<const uint32_t> rgba_img, MatrixView<uint32_t> hsva_img)
+{
+  utils::transform(rgba_img, hsva_img, [](uint32_t rgba_pixel) {
+    return HSVAPixel(RGBAPixel(rgba_pixel)).to_uint32_t();
+  });
+}
+
+void hsva_to_rgba(MatrixView<const uint32_t> hsva_img, MatrixView<uint32_t> rgba_img)
+{
+  utils::transform(hsva_img, rgba_img, [](uint32_t hsva_pixel) {
+    return HSVAPixel(hsva_pixel).to_rgba_pixel().to_uint32_t();
+  });
+}
+
 std::shared_ptr<Matrix<uint32_t>> hsva_transformation(std::shared_ptr<Matrix<uint32_t>> hsva_img,
                                                       double hue_rotation,
                                                       double saturation_factor,
                                                       double value_factor)
 {
   auto out_img = std::make_shared<Matrix<uint32_t>>(hsva_img->get_rows(), hsva_img->get_cols());
-  for (size_t row = 0; row < hsva_img->get_rows(); ++row) {
-    for (size_t col = 0; col < hsva_img->get_cols(); ++col) {
-      HSVAPixel pix(hsva_img->operator()(row, col));
-      pix.rotate_hue(hue_rotation);
-      // if (saturation_factor != 1.)
-      //   pix.amplify_saturation(saturation_factor);
-      // if (value_factor != 1.)
-      //   pix.amplify_value(value_factor);
-      out_img->operator()(row, col) = pix.to_uint32_t();
-    }
-  }
+  hsva_transformation(hsva_img->view(), out_img->view(), hue_rotation, saturation_factor, value_factor);
   return out_img;
 }
+
+void hsva_transformation(MatrixView<const uint32_t> hsva_img,
+                         MatrixView<uint32_t> out_img,
+                         double hue_rotation,
+                         double saturation_factor,
+                         double value_factor)
+{
+  utils::transform(hsva_img, out_img, [hue_rotation](uint32_t hsva_pixel) {
+    HSVAPixel pix(hsva_pixel);
+    pix.rotate_hue(hue_rotation);
+    // if (saturation_factor != 1.)
+    //   pix.amplify_saturation(saturation_factor);
+    // if (value_factor != 1.)
+    //   pix.amplify_value(value_factor);
+    return pix.to_uint32_t();
+  });
+}
 }
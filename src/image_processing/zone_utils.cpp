@@ -1,32 +1,44 @@
 #include "image_processing/zone_utils.h"
 #include <cstdio>
 
+#include "utils/parallel.h"
+
 namespace ip {
 std::shared_ptr<Matrix<uint8_t>> get_borders(std::shared_ptr<Matrix<uint8_t>> img,
                                              uint8_t threshold,
                                              int neighborhood_size)
 {
   std::shared_ptr<Matrix<uint8_t>> border_img = std::make_shared<Matrix<uint8_t>>(img->get_rows(), img->get_cols());
+  border_img->fill(0);
 
   // Here we consider a pixel is on a border if at least one of its neighbors has a different value
-  for (size_t row = 0; row < img->get_rows(); ++row) {
-    for (size_t col = 0; col < img->get_cols(); ++col) {
-      if (is_border(img, row, col, threshold, neighborhood_size)) {
-        border_img->operator()(row, col) = 255;
+  MatrixView<const uint8_t> img_view = img->view();
+  utils::parallel_for(img->get_rows(), [&](size_t row_begin, size_t row_end) {
+    for (size_t row = row_begin; row < row_end; ++row) {
+      uint8_t* border_row = border_img->row_ptr(row);
+      for (size_t col = 0; col < img->get_cols(); ++col) {
+        if (is_border(img_view, row, col, threshold, neighborhood_size)) {
+          border_row[col] = 255;
+        }
       }
     }
-  }
+  });
   return border_img;
 }
 
 bool is_border(std::shared_ptr<Matrix<uint8_t>> img, int row, int col, uint8_t threshold, int neighborhood_size)
 {
-  uint8_t value = img->operator()(row, col);
+  return is_border(MatrixView<const uint8_t>(img->view()), row, col, threshold, neighborhood_size);
+}
+
+bool is_border(MatrixView<const uint8_t> img, int row, int col, uint8_t threshold, int neighborhood_size)
+{
+  uint8_t value = img(row, col);
   for (int row_shift = -neighborhood_size; row_shift <= neighborhood_size; ++row_shift) {
     for (int col_shift = -neighborhood_size; col_shift <= neighborhood_size; ++col_shift) {
-      if (img->is_inside(row + row_shift, col + col_shift)) {
-        if (img->operator()(row + row_shift, col + col_shift) > value + threshold ||
-            img->operator()(row + row_shift, col + col_shift) < value - threshold) {
+      if (img.is_inside(row + row_shift, col + col_shift)) {
+        if (img(row + row_shift, col + col_shift) > value + threshold ||
+            img(row + row_shift, col + col_shift) < value - threshold) {
           return true;
         }
       }
@@ -35,11 +47,11 @@ bool is_border(std::shared_ptr<Matrix<uint8_t>> img, int row, int col, uint8_t t
   return false;
 }
 
-std::vector<std::shared_ptr<Matrix<uint32_t>>> extract_zone_images(std::shared_ptr<Matrix<uint32_t>> rgba_img,
-                                                                   std::shared_ptr<Matrix<uint8_t>> zone_img,
-                                                                   int number_of_clusters)
+std::vector<ZoneROI> extract_zone_rois(std::shared_ptr<Matrix<uint32_t>> rgba_img,
+                                       std::shared_ptr<Matrix<uint8_t>> zone_img,
+                                       int number_of_clusters)
 {
-  std::vector<std::shared_ptr<Matrix<uint32_t>>> extracted_images;
+  std::vector<ZoneROI> rois;
 
   std::vector<uint8_t> zone_values;
   uint8_t color_inc = uint8_t(255 / (number_of_clusters - 1));
@@ -71,15 +83,32 @@ std::vector<std::shared_ptr<Matrix<uint32_t>>> extract_zone_images(std::shared_p
       }
     }
 
-    // Create a sub-image with zone
+    // Zone does not appear in the image, keep an empty ROI so that indexes still match zone values
+    if (row_min > row_max || col_min > col_max) {
+      rois.push_back(ZoneROI{ value, MatrixView<const uint32_t>(), MatrixView<const uint8_t>() });
+      continue;
+    }
+
     const size_t sub_rows = row_max - row_min;
     const size_t sub_cols = col_max - col_min;
-    auto sub_img = std::make_shared<Matrix<uint32_t>>(sub_rows, sub_cols);
-    for (size_t row = 0; row < sub_rows; ++row) {
-      for (size_t col = 0; col < sub_cols; ++col) {
-        if (zone_img->operator()(row + row_min, col + col_min) == value) {
-          sub_img->operator()(row, col) = rgba_img->operator()(row + row_min, col + col_min);
-        }
+    rois.push_back(ZoneROI{ value,
+                            rgba_img->view(row_min, col_min, sub_rows, sub_cols),
+                            zone_img->view(row_min, col_min, sub_rows, sub_cols) });
+  }
+  return rois;
+}
+
+std::vector<std::shared_ptr<Matrix<uint32_t>>> extract_zone_images(std::shared_ptr<Matrix<uint32_t>> rgba_img,
+                                                                   std::shared_ptr<Matrix<uint8_t>> zone_img,
+                                                                   int number_of_clusters)
+{
+  std::vector<std::shared_ptr<Matrix<uint32_t>>> extracted_images;
+  for (const auto& roi : extract_zone_rois(rgba_img, zone_img, number_of_clusters)) {
+    // Create a sub-image with zone
+    auto sub_img = std::make_shared<Matrix<uint32_t>>(roi.rgba_view.get_rows(), roi.rgba_view.get_cols());
+    for (size_t row = 0; row < roi.rgba_view.get_rows(); ++row) {
+      for (size_t col = 0; col < roi.rgba_view.get_cols(); ++col) {
+        sub_img->operator()(row, col) = roi.zone_view(row, col) == roi.zone_value ? roi.rgba_view(row, col) : 0;
       }
     }
     extracted_images.push_back(sub_img);
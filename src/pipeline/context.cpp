@@ -20,11 +20,24 @@ void Context::add_image(std::string img_name, Image img)
   } else if (img.type == ImageType::FULL) {
     add_gray_image(img_name, img.gray_img);
     add_rgba_image(img_name, img.rgba_img);
+  } else if (img.type == ImageType::PLANAR) {
+    add_planar_image(img_name, img.planar_img);
+  } else if (img.type == ImageType::GRAY16) {
+    add_gray16_image(img_name, img.gray16_img);
   }
 }
 
 Image Context::get_image(std::string img_name)
 {
+  auto planar_img = get_planar_image(img_name);
+  if (planar_img) {
+    return Image(planar_img);
+  }
+  auto gray16_img = get_gray16_image(img_name);
+  if (gray16_img) {
+    return Image(gray16_img);
+  }
+
   Image img;
   auto rgba_img = get_rgba_image(img_name);
   if (rgba_img->get_cols() != 0) {
@@ -46,12 +59,20 @@ void Context::delete_image(std::string img_name)
 {
   imgs.erase(img_name);
   gray_imgs.erase(img_name);
+  planar_imgs.erase(img_name);
+  gray16_imgs.erase(img_name);
 }
 
 void Context::save_image(std::string img_name, std::string filepath)
 {
   Image img = get_image(img_name);
   bool is_png = filepath.substr(filepath.size() - 3) == "png";
+  if (img.type == ImageType::PLANAR) {
+    img = Image(ip::planar_to_rgba(img.planar_img));
+  }
+  if (img.type == ImageType::GRAY16) {
+    img = Image(ip::convert_pixel_format<uint8_t>(img.gray16_img));
+  }
   if (img.type == ImageType::FULL || img.type == ImageType::RGBA) {
     if (is_png) {
       save_rgba_image_png(img.rgba_img, filepath);
@@ -107,6 +128,34 @@ std::shared_ptr<Matrix<uint8_t>> Context::get_gray_image(std::string img_name, b
   return img->second;
 }
 
+void Context::add_planar_image(std::string img_name, std::shared_ptr<PlanarImage> img)
+{
+  planar_imgs.insert({ img_name, img });
+}
+
+std::shared_ptr<PlanarImage> Context::get_planar_image(std::string img_name)
+{
+  auto img = planar_imgs.find(img_name);
+  if (img == planar_imgs.end()) {
+    return nullptr;
+  }
+  return img->second;
+}
+
+void Context::add_gray16_image(std::string img_name, std::shared_ptr<Matrix<uint16_t>> img)
+{
+  gray16_imgs.insert({ img_name, img });
+}
+
+std::shared_ptr<Matrix<uint16_t>> Context::get_gray16_image(std::string img_name)
+{
+  auto img = gray16_imgs.find(img_name);
+  if (img == gray16_imgs.end()) {
+    return nullptr;
+  }
+  return img->second;
+}
+
 void Context::save_gray_image(std::string img_name)
 {
   auto gray_img = get_gray_image(img_name);
@@ -120,17 +169,16 @@ void Context::save_gray_image(std::string img_name)
 
 void Context::save_gray_image_png(std::shared_ptr<Matrix<uint8_t>> gray_img, std::string filepath)
 {
-  size_t img_width = gray_img->get_cols();
-  size_t img_height = gray_img->get_rows();
   std::vector<uint8_t> png_data;
   png_data.resize(gray_img->get_cols() * gray_img->get_rows() * 4);
-  for (size_t row = 0; row < img_height; ++row) {
-    for (size_t col = 0; col < img_width; ++col) {
-      uint8_t pixel = gray_img->operator()(row, col);
-      png_data[(row * img_width + col) * 4] = pixel;
-      png_data[(row * img_width + col) * 4 + 1] = pixel;
-      png_data[(row * img_width + col) * 4 + 2] = pixel;
-      png_data[(row * img_width + col) * 4 + 3] = 255;
+  uint8_t* png_pixel = png_data.data();
+  for (auto gray_row : *gray_img) {
+    for (uint8_t pixel : gray_row) {
+      png_pixel[0] = pixel;
+      png_pixel[1] = pixel;
+      png_pixel[2] = pixel;
+      png_pixel[3] = 255;
+      png_pixel += 4;
     }
   }
 
@@ -150,13 +198,23 @@ void Context::save_rgba_image(std::string img_name)
 
 void Context::save_rgba_image_png(std::shared_ptr<Matrix<uint32_t>> rgba_img, std::string filepath)
 {
-  size_t img_width = rgba_img->get_cols();
-  size_t img_height = rgba_img->get_rows();
+  save_rgba_image_png(rgba_img->view(), filepath);
+}
+
+void Context::save_rgba_image_png(MatrixView<const uint32_t> rgba_img,
+                                  std::string filepath,
+                                  MatrixView<const uint8_t> mask,
+                                  uint8_t mask_value)
+{
+  size_t img_width = rgba_img.get_cols();
+  size_t img_height = rgba_img.get_rows();
+  bool use_mask = !mask.empty();
   std::vector<uint8_t> png_data;
-  png_data.resize(rgba_img->get_cols() * rgba_img->get_rows() * 3);
+  png_data.resize(img_width * img_height * 3);
   for (size_t row = 0; row < img_height; ++row) {
     for (size_t col = 0; col < img_width; ++col) {
-      RGBAPixel rgba_pixel = RGBAPixel(rgba_img->operator()(row, col));
+      RGBAPixel rgba_pixel =
+        use_mask && mask(row, col) != mask_value ? RGBAPixel(0, 0, 0) : RGBAPixel(rgba_img(row, col));
       png_data[(row * img_width + col) * 3] = rgba_pixel.r;
       png_data[(row * img_width + col) * 3 + 1] = rgba_pixel.g;
       png_data[(row * img_width + col) * 3 + 2] = rgba_pixel.b;
@@ -173,12 +231,14 @@ void Context::save_rgba_image(std::shared_ptr<Matrix<uint32_t>> rgba_img, std::s
   size_t img_width = rgba_img->get_cols();
   size_t img_height = rgba_img->get_rows();
   JSAMPLE* image_buffer = new JSAMPLE[img_height * img_width * 3];
-  for (size_t row = 0; row < img_height; ++row) {
-    for (size_t col = 0; col < img_width; ++col) {
-      RGBAPixel rgba_pixel = RGBAPixel(rgba_img->operator()(row, col));
-      image_buffer[(row * img_width + col) * 3] = rgba_pixel.r;
-      image_buffer[(row * img_width + col) * 3 + 1] = rgba_pixel.g;
-      image_buffer[(row * img_width + col) * 3 + 2] = rgba_pixel.b;
+  JSAMPLE* buffer_pixel = image_buffer;
+  for (auto rgba_row : *rgba_img) {
+    for (uint32_t pixel : rgba_row) {
+      RGBAPixel rgba_pixel = RGBAPixel(pixel);
+      buffer_pixel[0] = rgba_pixel.r;
+      buffer_pixel[1] = rgba_pixel.g;
+      buffer_pixel[2] = rgba_pixel.b;
+      buffer_pixel += 3;
     }
   }
 
@@ -1,6 +1,7 @@
 #include "pipeline/image_processing/canny_processor.h"
 
 #include "image_processing/canny.h"
+#include "image_processing/utils.h"
 
 CannyProcessor::CannyProcessor()
 {
@@ -23,6 +24,10 @@ bool CannyProcessor::process(Context& context, std::string img_name, std::string
   CannyEdgeDetector canny_edge_detector(low_threshold, high_threshold);
   if (img.type == ImageType::GRAY || img.type == ImageType::FULL) {
     canny_edge_detector.process_gray_img(img.gray_img);
+  } else if (img.type == ImageType::PLANAR) {
+    canny_edge_detector.process_gray_img(ip::planar_to_gray(img.planar_img));
+  } else if (img.type == ImageType::GRAY16) {
+    canny_edge_detector.process_gray_img(ip::convert_pixel_format<uint8_t>(img.gray16_img));
   } else {
     canny_edge_detector.process_rgba_img(img.rgba_img);
   }
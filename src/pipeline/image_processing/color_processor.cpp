@@ -12,6 +12,11 @@ ColorConversionProcessor::ColorConversionProcessor()
   transformations.add_value(COLOR_HSV2RGB);
   transformations.add_value(COLOR_RGB2GRAY);
   transformations.add_value(COLOR_GRAY2RGB);
+  transformations.add_value(COLOR_RGB2PLANAR);
+  transformations.add_value(COLOR_PLANAR2RGB);
+  transformations.add_value(COLOR_GRAY2GRAY16);
+  transformations.add_value(COLOR_GRAY162GRAY);
+  transformations.add_value(COLOR_RGB2GRAY16);
   config.set_enum_property(COLOR_TRANSFORMATION, transformations);
 }
 
@@ -27,13 +32,18 @@ bool ColorConversionProcessor::process(Context& context, std::string img_name, s
     if (img.type != ImageType::FULL && img.type != ImageType::RGBA) {
       return false;
     }
-    auto hsva_img = ip::rgba_to_hsva(img.rgba_img);
+    // In place when the conversion replaces an image that is not shared
+    context.delete_image(output_img_name);
+    auto hsva_img = make_output(img.rgba_img);
+    ip::rgba_to_hsva(img.rgba_img->view(), hsva_img->view());
     context.add_image(output_img_name, Image(hsva_img));
   } else if (transformation == COLOR_HSV2RGB) {
     if (img.type != ImageType::FULL && img.type != ImageType::RGBA) {
       return false;
     }
-    auto rgba_img = ip::hsva_to_rgba(img.rgba_img);
+    context.delete_image(output_img_name);
+    auto rgba_img = make_output(img.rgba_img);
+    ip::hsva_to_rgba(img.rgba_img->view(), rgba_img->view());
     context.add_image(output_img_name, Image(rgba_img));
   } else if (transformation == COLOR_RGB2GRAY) {
     if (img.type != ImageType::FULL && img.type != ImageType::RGBA) {
@@ -42,11 +52,44 @@ bool ColorConversionProcessor::process(Context& context, std::string img_name, s
     auto gray_img = ip::rgba_to_gray(img.rgba_img);
     context.add_image(output_img_name, Image(gray_img));
   } else if (transformation == COLOR_GRAY2RGB) {
-    if (img.type != ImageType::GRAY && img.type != ImageType::FULL) {
+    if (img.type == ImageType::GRAY || img.type == ImageType::FULL) {
+      context.add_image(output_img_name, Image(ip::gray_to_rgba(img.gray_img)));
+    } else if (img.type == ImageType::GRAY16) {
+      context.add_image(output_img_name, Image(ip::gray_to_rgba(img.gray16_img)));
+    } else {
+      return false;
+    }
+  } else if (transformation == COLOR_RGB2PLANAR) {
+    if (img.type != ImageType::FULL && img.type != ImageType::RGBA) {
       return false;
     }
-    auto rgba_img = ip::gray_to_rgba(img.gray_img);
+    auto planar_img = ip::rgba_to_planar(img.rgba_img);
+    context.add_image(output_img_name, Image(planar_img));
+  } else if (transformation == COLOR_PLANAR2RGB) {
+    if (img.type != ImageType::PLANAR) {
+      return false;
+    }
+    auto rgba_img = ip::planar_to_rgba(img.planar_img);
     context.add_image(output_img_name, Image(rgba_img));
+  } else if (transformation == COLOR_GRAY2GRAY16) {
+    if (img.type != ImageType::GRAY && img.type != ImageType::FULL) {
+      return false;
+    }
+    auto gray16_img = ip::convert_pixel_format<uint16_t>(img.gray_img);
+    context.add_image(output_img_name, Image(gray16_img));
+  } else if (transformation == COLOR_GRAY162GRAY) {
+    if (img.type != ImageType::GRAY16) {
+      return false;
+    }
+    auto gray_img = ip::convert_pixel_format<uint8_t>(img.gray16_img);
+    context.add_image(output_img_name, Image(gray_img));
+  } else if (transformation == COLOR_RGB2GRAY16) {
+    if (img.type != ImageType::FULL && img.type != ImageType::RGBA) {
+      return false;
+    }
+    // Straight from the color channels, without the 8 bit gray rounding
+    auto gray16_img = ip::rgba_to_gray<uint16_t>(img.rgba_img);
+    context.add_image(output_img_name, Image(gray16_img));
   } else {
     return false;
   }
@@ -69,14 +112,17 @@ HSVProcessor::HSVProcessor()
 bool HSVProcessor::process(Context& context, std::string img_name, std::string output_img_name)
 {
   Image img = context.get_image(img_name);
-  if (img.type == ImageType::UNKNOWN || img.type == ImageType::GRAY) {
+  if (img.type == ImageType::UNKNOWN || img.type == ImageType::GRAY || img.type == ImageType::PLANAR ||
+      img.type == ImageType::GRAY16) {
     return false;
   }
 
   double hue_rotation = config.get_double(HSV_HUE_ROTATION);
   double saturation_factor = config.get_double(HSV_SATURATION_FACTOR);
   double value_factor = config.get_double(HSV_VALUE_FACTOR);
-  auto out_img = ip::hsva_transformation(img.rgba_img, hue_rotation, saturation_factor, value_factor);
+  context.delete_image(output_img_name);
+  auto out_img = make_output(img.rgba_img);
+  ip::hsva_transformation(img.rgba_img->view(), out_img->view(), hue_rotation, saturation_factor, value_factor);
   context.add_image(output_img_name, Image(out_img));
   return true;
 }
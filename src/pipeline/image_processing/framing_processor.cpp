@@ -1,6 +1,7 @@
 #include "pipeline/image_processing/framing_processor.h"
 
 #include "image_processing/framing.h"
+#include "utils/parallel.h"
 
 FramingProcessor::FramingProcessor()
 {
@@ -37,7 +38,7 @@ bool FramingProcessor::process(Context& context, std::string img_name, std::stri
   return true;
 }
 
-bool FramingProcessor::apply_framing(Context context,
+bool FramingProcessor::apply_framing(Context& context,
                                      std::string base_img_name,
                                      std::string framing_img_name,
                                      std::string output_img_name)
@@ -52,21 +53,26 @@ bool FramingProcessor::apply_framing(Context context,
   if (framing_img.type != ImageType::GRAY) {
     return false;
   }
+  const Matrix<uint8_t>& frame = *framing_img.gray_img;
+  if (frame.get_rows() != img.rgba_img->get_rows() || frame.get_cols() != img.rgba_img->get_cols()) {
+    return false;
+  }
 
-  // Initialize output image
-  auto img_out = std::make_shared<Matrix<uint32_t>>(img.rgba_img->get_rows(), img.rgba_img->get_cols());
-
-  size_t img_width = img.rgba_img->get_cols();
-  size_t img_height = img.rgba_img->get_rows();
-  for (size_t row = 0; row < img_height; ++row) {
-    for (size_t col = 0; col < img_width; ++col) {
-      if (framing_img.gray_img->operator()(row, col) != 0) {
-        img_out->operator()(row, col) = 0;
-      } else {
-        img_out->operator()(row, col) = img.rgba_img->operator()(row, col);
+  // Black out the frame borders, keep the base image everywhere else. Only the border pixels are written: the base
+  // image is copied first when it is shared, and modified in place when the output replaces it
+  context.delete_image(output_img_name);
+  auto img_out = make_writable(img.rgba_img);
+  utils::parallel_for(frame.get_rows(), [&frame, &img_out](size_t row_begin, size_t row_end) {
+    for (size_t row = row_begin; row < row_end; ++row) {
+      const uint8_t* frame_row = frame.row_ptr(row);
+      uint32_t* output_row = img_out->row_ptr(row);
+      for (size_t col = 0; col < frame.get_cols(); ++col) {
+        if (frame_row[col] != 0) {
+          output_row[col] = 0;
+        }
       }
     }
-  }
+  });
 
   context.add_image(output_img_name, Image(img_out));
   return true;
@@ -24,7 +24,8 @@ bool KMeansProcessor::process(Context& context, std::string img_name, std::strin
   auto img = context.get_image(img_name);
 
   // If image is null, return false
-  if (img.type == ImageType::UNKNOWN || img.type == ImageType::GRAY) {
+  if (img.type == ImageType::UNKNOWN || img.type == ImageType::GRAY || img.type == ImageType::PLANAR ||
+      img.type == ImageType::GRAY16) {
     return false;
   }
 
@@ -27,6 +27,12 @@ bool NormalizationProcessor::process(Context& context, std::string img_name, std
   } else if (img.type == ImageType::GRAY) {
     auto res_img = ip::min_max_normalization(img.gray_img);
     context.add_image(output_img_name, Image(res_img));
+  } else if (img.type == ImageType::GRAY16) {
+    auto res_img = ip::min_max_normalization(img.gray16_img);
+    context.add_image(output_img_name, Image(res_img));
+  } else if (img.type == ImageType::PLANAR) {
+    auto res_img = ip::min_max_normalization(img.planar_img);
+    context.add_image(output_img_name, Image(res_img));
   } else {
     return false;
   }
@@ -33,6 +33,17 @@ bool ResizingProcessor::process(Context& context, std::string img_name, std::str
 
   if (img.type == ImageType::GRAY) {
     context.add_image(output_img_name, Image(ip::resize(img.gray_img, target_rows, target_cols, interpolation_type)));
+  } else if (img.type == ImageType::GRAY16) {
+    context.add_image(output_img_name,
+                      Image(ip::resize(img.gray16_img, target_rows, target_cols, interpolation_type)));
+  } else if (img.type == ImageType::PLANAR) {
+    auto res_img = std::make_shared<PlanarImage>();
+    for (size_t channel = 0; channel < PlanarImage::N_CHANNELS; ++channel) {
+      // Aliasing constructor, the plane is shared with (and kept alive by) the planar image
+      std::shared_ptr<Matrix<uint8_t>> plane(img.planar_img, &img.planar_img->plane(channel));
+      res_img->plane(channel) = std::move(*ip::resize(plane, target_rows, target_cols, interpolation_type));
+    }
+    context.add_image(output_img_name, Image(res_img));
   } else {
     context.add_image(output_img_name, Image(ip::resize(img.rgba_img, target_rows, target_cols, interpolation_type)));
   }
@@ -17,7 +17,8 @@ SimilitudeProcessor::SimilitudeProcessor()
 bool SimilitudeProcessor::process(Context& context, std::string img_name, std::string output_img_name)
 {
   auto img = context.get_image(img_name);
-  if (img.type == ImageType::UNKNOWN || img.type == ImageType::GRAY) {
+  if (img.type == ImageType::UNKNOWN || img.type == ImageType::GRAY || img.type == ImageType::PLANAR ||
+      img.type == ImageType::GRAY16) {
     return false;
   }
 
@@ -1,8 +1,59 @@
 #include "pipeline/image_processing/spatial_filtering.h"
 
+#include "image_processing/box_filter.h"
+#include "image_processing/guided_filter.h"
+#include "image_processing/median_filter.h"
 #include "image_processing/morphological_operations.h"
+#include "image_processing/recursive_gaussian.h"
 #include "image_processing/spatial_filtering.h"
 
+namespace {
+ip::BorderMode get_border_mode(Configuration& config)
+{
+  std::string border_mode = config.get_enum_value(SF_BORDER_MODE);
+  if (border_mode == SF_BORDER_REPLICATE) {
+    return ip::BorderMode::REPLICATE;
+  } else if (border_mode == SF_BORDER_REFLECT) {
+    return ip::BorderMode::REFLECT;
+  } else if (border_mode == SF_BORDER_WRAP) {
+    return ip::BorderMode::WRAP;
+  }
+  return ip::BorderMode::CONSTANT;
+}
+
+// Variances of gray images are stored on 16 bits, which holds the variance of any 8 bits window
+template<typename T>
+std::shared_ptr<Matrix<uint16_t>> gray_variance(std::shared_ptr<Matrix<T>> input_img,
+                                                size_t kernel_size,
+                                                ip::BorderMode border_mode)
+{
+  auto variance_img = std::make_shared<Matrix<float>>(input_img->get_rows(), input_img->get_cols());
+  ip::local_variance(input_img, kernel_size, variance_img, border_mode);
+  auto res_img = std::make_shared<Matrix<uint16_t>>(input_img->get_rows(), input_img->get_cols());
+  utils::transform(MatrixView<const float>(variance_img->view()), res_img->view(), [](float value) {
+    return PixelTraits<uint16_t>::saturate(value);
+  });
+  return res_img;
+}
+
+// The 3x3 and 5x5 edge kernels are known at compile time and take the unrolled path
+template<typename InputImage, typename OutputImage>
+void apply_edge_kernel(InputImage input_img,
+                       std::shared_ptr<Matrix<float>> kernel,
+                       OutputImage output_img,
+                       int kernel_size,
+                       ip::BorderMode border_mode)
+{
+  if (kernel_size == 3) {
+    ip::apply_kernel(input_img, ip::EDGE_3X3_KERNEL, output_img, border_mode);
+  } else if (kernel_size == 5) {
+    ip::apply_kernel(input_img, ip::EDGE_5X5_KERNEL, output_img, border_mode);
+  } else {
+    ip::apply_kernel(input_img, kernel, output_img, border_mode);
+  }
+}
+}
+
 // ------------------------------------------------------------------------------------------------
 //                                     SPATIAL FILTERING BASE
 // ------------------------------------------------------------------------------------------------
@@ -10,6 +61,14 @@ SpatialFilteringProcessor::SpatialFilteringProcessor()
 {
   processor_name = "Spatial filtering processor";
   processor_suffix = "_sp_base";
+
+  // Value of the pixels outside of the image, shared by every kernel based processor
+  EnumType border_modes;
+  border_modes.add_value(SF_BORDER_CONSTANT);
+  border_modes.add_value(SF_BORDER_REPLICATE);
+  border_modes.add_value(SF_BORDER_REFLECT);
+  border_modes.add_value(SF_BORDER_WRAP);
+  config.set_enum_property(SF_BORDER_MODE, border_modes);
 }
 
 bool SpatialFilteringProcessor::process(Context& context, std::string img_name, std::string output_img_name)
@@ -23,13 +82,32 @@ bool SpatialFilteringProcessor::process(Context& context, std::string img_name,
 
   // Apply kernel
   auto kernel = create_kernel(config);
-  if (img.type == ImageType::RGBA || img.type == ImageType::FULL) {
+  ip::BorderMode border_mode = get_border_mode(config);
+  // Only gray and RGBA images have a fixed point path, processors without the property read false
+  bool fixed_point = config.get_bool(SF_FIXED_POINT);
+  if (img.type == ImageType::PLANAR) {
+    auto res_img = std::make_shared<PlanarImage>(img.planar_img->get_rows(), img.planar_img->get_cols());
+    ip::apply_kernel(img.planar_img, kernel, res_img, border_mode);
+    context.add_image(output_img_name, Image(res_img));
+  } else if (img.type == ImageType::GRAY16) {
+    auto res_img = std::make_shared<Matrix<uint16_t>>(img.gray16_img->get_rows(), img.gray16_img->get_cols());
+    ip::apply_kernel(img.gray16_img, kernel, res_img, border_mode);
+    context.add_image(output_img_name, Image(res_img));
+  } else if (img.type == ImageType::RGBA || img.type == ImageType::FULL) {
     auto res_img = std::make_shared<Matrix<uint32_t>>(img.rgba_img->get_rows(), img.rgba_img->get_cols());
-    ip::apply_kernel(img.rgba_img, kernel, res_img);
+    if (fixed_point) {
+      ip::apply_kernel_fixed_point(img.rgba_img, kernel, res_img, border_mode);
+    } else {
+      ip::apply_kernel(img.rgba_img, kernel, res_img, border_mode);
+    }
     context.add_image(output_img_name, Image(res_img));
   } else {
     auto res_img = std::make_shared<Matrix<uint8_t>>(img.gray_img->get_rows(), img.gray_img->get_cols());
-    ip::apply_kernel(img.gray_img, kernel, res_img);
+    if (fixed_point) {
+      ip::apply_kernel_fixed_point(img.gray_img, kernel, res_img, border_mode);
+    } else {
+      ip::apply_kernel(img.gray_img, kernel, res_img, border_mode);
+    }
     context.add_image(output_img_name, Image(res_img));
   }
   return true;
@@ -46,6 +124,49 @@ GaussianBlurProcessor::GaussianBlurProcessor()
   // Setup configuration
   config.set_integer_property(KERNEL_SIZE, 5);
   config.set_double_property(KERNEL_STD, 1.0);
+  config.set_boolean_property(SF_FIXED_POINT, false);
+
+  // The recursive filter ignores the kernel size, its cost does not depend on sigma
+  EnumType methods;
+  methods.add_value(GB_METHOD_KERNEL);
+  methods.add_value(GB_METHOD_RECURSIVE);
+  config.set_enum_property(GB_METHOD, methods);
+}
+
+bool GaussianBlurProcessor::process(Context& context, std::string img_name, std::string output_img_name)
+{
+  // Small blurs stay on the kernel path, the recursive filter is inaccurate there
+  float sigma = float(config.get_double(KERNEL_STD));
+  if (config.get_enum_value(GB_METHOD) != GB_METHOD_RECURSIVE || sigma < ip::IIR_GAUSSIAN_MIN_SIGMA) {
+    return SpatialFilteringProcessor::process(context, img_name, output_img_name);
+  }
+
+  auto img = context.get_image(img_name);
+
+  // If image is null, return false
+  if (img.type == ImageType::UNKNOWN) {
+    return false;
+  }
+
+  ip::BorderMode border_mode = get_border_mode(config);
+  if (img.type == ImageType::PLANAR) {
+    auto res_img = std::make_shared<PlanarImage>(img.planar_img->get_rows(), img.planar_img->get_cols());
+    ip::recursive_gaussian_blur(img.planar_img, sigma, res_img, border_mode);
+    context.add_image(output_img_name, Image(res_img));
+  } else if (img.type == ImageType::GRAY16) {
+    auto res_img = std::make_shared<Matrix<uint16_t>>(img.gray16_img->get_rows(), img.gray16_img->get_cols());
+    ip::recursive_gaussian_blur(img.gray16_img, sigma, res_img, border_mode);
+    context.add_image(output_img_name, Image(res_img));
+  } else if (img.type == ImageType::RGBA || img.type == ImageType::FULL) {
+    auto res_img = std::make_shared<Matrix<uint32_t>>(img.rgba_img->get_rows(), img.rgba_img->get_cols());
+    ip::recursive_gaussian_blur(img.rgba_img, sigma, res_img, border_mode);
+    context.add_image(output_img_name, Image(res_img));
+  } else {
+    auto res_img = std::make_shared<Matrix<uint8_t>>(img.gray_img->get_rows(), img.gray_img->get_cols());
+    ip::recursive_gaussian_blur(img.gray_img, sigma, res_img, border_mode);
+    context.add_image(output_img_name, Image(res_img));
+  }
+  return true;
 }
 
 std::shared_ptr<Matrix<float>> GaussianBlurProcessor::create_kernel(Configuration& config)
@@ -55,6 +176,183 @@ std::shared_ptr<Matrix<float>> GaussianBlurProcessor::create_kernel(Configuratio
   return ip::create_gaussian_kernel(kernel_size, sigma);
 }
 
+// ------------------------------------------------------------------------------------------------
+//                                     BOX FILTER
+// ------------------------------------------------------------------------------------------------
+BoxFilterProcessor::BoxFilterProcessor()
+{
+  processor_name = "Box filter processor";
+  processor_suffix = "_box_filter";
+
+  // Setup configuration
+  config.set_integer_property(KERNEL_SIZE, 5);
+
+  EnumType statistics;
+  statistics.add_value(BOX_STATISTIC_MEAN);
+  statistics.add_value(BOX_STATISTIC_VARIANCE);
+  config.set_enum_property(BOX_STATISTIC, statistics);
+}
+
+bool BoxFilterProcessor::process(Context& context, std::string img_name, std::string output_img_name)
+{
+  auto img = context.get_image(img_name);
+
+  // If image is null, return false
+  if (img.type == ImageType::UNKNOWN) {
+    return false;
+  }
+
+  size_t kernel_size = size_t(std::max(config.get_int(KERNEL_SIZE), 1));
+  bool variance = config.get_enum_value(BOX_STATISTIC) == BOX_STATISTIC_VARIANCE;
+  ip::BorderMode border_mode = get_border_mode(config);
+  if (img.type == ImageType::PLANAR) {
+    auto res_img = std::make_shared<PlanarImage>(img.planar_img->get_rows(), img.planar_img->get_cols());
+    if (variance) {
+      ip::local_variance(img.planar_img, kernel_size, res_img, border_mode);
+    } else {
+      ip::box_filter(img.planar_img, kernel_size, res_img, border_mode);
+    }
+    context.add_image(output_img_name, Image(res_img));
+  } else if (img.type == ImageType::GRAY16) {
+    if (variance) {
+      context.add_image(output_img_name, Image(gray_variance(img.gray16_img, kernel_size, border_mode)));
+    } else {
+      auto res_img = std::make_shared<Matrix<uint16_t>>(img.gray16_img->get_rows(), img.gray16_img->get_cols());
+      ip::box_filter(img.gray16_img, kernel_size, res_img, border_mode);
+      context.add_image(output_img_name, Image(res_img));
+    }
+  } else if (img.type == ImageType::RGBA || img.type == ImageType::FULL) {
+    auto res_img = std::make_shared<Matrix<uint32_t>>(img.rgba_img->get_rows(), img.rgba_img->get_cols());
+    if (variance) {
+      ip::local_variance(img.rgba_img, kernel_size, res_img, border_mode);
+    } else {
+      ip::box_filter(img.rgba_img, kernel_size, res_img, border_mode);
+    }
+    context.add_image(output_img_name, Image(res_img));
+  } else {
+    if (variance) {
+      context.add_image(output_img_name, Image(gray_variance(img.gray_img, kernel_size, border_mode)));
+    } else {
+      auto res_img = std::make_shared<Matrix<uint8_t>>(img.gray_img->get_rows(), img.gray_img->get_cols());
+      ip::box_filter(img.gray_img, kernel_size, res_img, border_mode);
+      context.add_image(output_img_name, Image(res_img));
+    }
+  }
+  return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+//                                     MEDIAN FILTER
+// ------------------------------------------------------------------------------------------------
+MedianFilterProcessor::MedianFilterProcessor()
+{
+  processor_name = "Median filter processor";
+  processor_suffix = "_median";
+
+  // Setup configuration
+  config.set_integer_property(KERNEL_SIZE, 3);
+}
+
+bool MedianFilterProcessor::process(Context& context, std::string img_name, std::string output_img_name)
+{
+  auto img = context.get_image(img_name);
+
+  // If image is null, return false
+  if (img.type == ImageType::UNKNOWN) {
+    return false;
+  }
+
+  size_t kernel_size = size_t(std::max(config.get_int(KERNEL_SIZE), 1));
+  ip::BorderMode border_mode = get_border_mode(config);
+  if (img.type == ImageType::PLANAR) {
+    auto res_img = std::make_shared<PlanarImage>(img.planar_img->get_rows(), img.planar_img->get_cols());
+    ip::median_filter(img.planar_img, kernel_size, res_img, border_mode);
+    context.add_image(output_img_name, Image(res_img));
+  } else if (img.type == ImageType::GRAY16) {
+    // Histograms are only built over 8 bits values
+    printf("Median filter is not available for 16 bits images\n");
+    return false;
+  } else if (img.type == ImageType::RGBA || img.type == ImageType::FULL) {
+    auto res_img = std::make_shared<Matrix<uint32_t>>(img.rgba_img->get_rows(), img.rgba_img->get_cols());
+    ip::median_filter(img.rgba_img, kernel_size, res_img, border_mode);
+    context.add_image(output_img_name, Image(res_img));
+  } else {
+    auto res_img = std::make_shared<Matrix<uint8_t>>(img.gray_img->get_rows(), img.gray_img->get_cols());
+    ip::median_filter(img.gray_img, kernel_size, res_img, border_mode);
+    context.add_image(output_img_name, Image(res_img));
+  }
+  return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+//                                     GUIDED FILTER
+// ------------------------------------------------------------------------------------------------
+GuidedFilterProcessor::GuidedFilterProcessor()
+{
+  processor_name = "Guided filter processor";
+  processor_suffix = "_guided";
+
+  // Setup configuration
+  config.set_integer_property(GF_RADIUS, 4);
+  // Variance of intensities in [0, 1], edges below about sqrt(epsilon) * 255 gray levels are smoothed
+  config.set_double_property(GF_EPSILON, 0.01);
+  config.set_string_property(GF_GUIDE, "");
+}
+
+bool GuidedFilterProcessor::process(Context& context, std::string img_name, std::string output_img_name)
+{
+  auto img = context.get_image(img_name);
+
+  // If image is null, return false
+  if (img.type == ImageType::UNKNOWN) {
+    return false;
+  }
+
+  std::string guide_name = config.get_string(GF_GUIDE);
+  auto guide = guide_name.empty() ? img : context.get_image(guide_name);
+  bool gray_guide = guide.type == ImageType::GRAY;
+  bool rgba_guide = guide.type == ImageType::RGBA || guide.type == ImageType::FULL;
+  if (!gray_guide && !rgba_guide) {
+    printf("Guided filter needs a gray or RGBA guide\n");
+    return false;
+  }
+
+  size_t radius = size_t(std::max(config.get_int(GF_RADIUS), 0));
+  float epsilon = float(config.get_double(GF_EPSILON));
+  ip::BorderMode border_mode = get_border_mode(config);
+  size_t guide_rows = gray_guide ? guide.gray_img->get_rows() : guide.rgba_img->get_rows();
+  size_t guide_cols = gray_guide ? guide.gray_img->get_cols() : guide.rgba_img->get_cols();
+  if (img.type == ImageType::RGBA || img.type == ImageType::FULL) {
+    if (img.rgba_img->get_rows() != guide_rows || img.rgba_img->get_cols() != guide_cols) {
+      printf("Guide and image sizes differ\n");
+      return false;
+    }
+    auto res_img = std::make_shared<Matrix<uint32_t>>(img.rgba_img->get_rows(), img.rgba_img->get_cols());
+    if (gray_guide) {
+      ip::guided_filter(img.rgba_img, guide.gray_img, radius, epsilon, res_img, border_mode);
+    } else {
+      ip::guided_filter(img.rgba_img, guide.rgba_img, radius, epsilon, res_img, border_mode);
+    }
+    context.add_image(output_img_name, Image(res_img));
+  } else if (img.type == ImageType::GRAY) {
+    if (img.gray_img->get_rows() != guide_rows || img.gray_img->get_cols() != guide_cols) {
+      printf("Guide and image sizes differ\n");
+      return false;
+    }
+    auto res_img = std::make_shared<Matrix<uint8_t>>(img.gray_img->get_rows(), img.gray_img->get_cols());
+    if (gray_guide) {
+      ip::guided_filter(img.gray_img, guide.gray_img, radius, epsilon, res_img, border_mode);
+    } else {
+      ip::guided_filter(img.gray_img, guide.rgba_img, radius, epsilon, res_img, border_mode);
+    }
+    context.add_image(output_img_name, Image(res_img));
+  } else {
+    printf("Guided filter is only available for gray and RGBA images\n");
+    return false;
+  }
+  return true;
+}
+
 // ------------------------------------------------------------------------------------------------
 //                                     EDGE DETECTION
 // ------------------------------------------------------------------------------------------------
@@ -66,6 +364,7 @@ EdgeDetectionProcessor::EdgeDetectionProcessor()
   // Setup configuration
   config.set_integer_property(KERNEL_SIZE, 5);
   config.set_double_property(KERNEL_STD, 1.0);
+  config.set_boolean_property(SF_FIXED_POINT, false);
 
   EnumType edge_detection_algorithms = EnumType();
   edge_detection_algorithms.add_value(EDGE_KERNEL_ALGORITHM);
@@ -78,28 +377,12 @@ std::shared_ptr<Matrix<float>> EdgeDetectionProcessor::create_kernel(Configurati
 {
   // kernel size can either be 3 or 5. If input is not 3, we create a 5x5 kernel
   size_t kernel_size = size_t(config.get_int(KERNEL_SIZE));
-  auto kernel = std::make_shared<Matrix<float>>(kernel_size, kernel_size);
-
   if (kernel_size == 3) {
-    for (size_t x = 0; x < kernel_size; ++x) {
-      for (size_t y = 0; y < kernel_size; ++y) {
-        kernel->operator()(x, y) = -0.125f;
-      }
-    }
-    kernel->operator()(1, 1) = 1.f;
+    return ip::EDGE_3X3_KERNEL.to_matrix();
   } else if (kernel_size == 5) {
-    for (size_t x = 0; x < kernel_size; ++x) {
-      for (size_t y = 0; y < kernel_size; ++y) {
-        kernel->operator()(x, y) = -1.f / 32.f;
-      }
-    }
-    for (size_t x = 1; x < kernel_size - 1; ++x) {
-      for (size_t y = 1; y < kernel_size - 1; ++y) {
-        kernel->operator()(x, y) = -2.f / 32.f;
-      }
-    }
-    kernel->operator()(2, 2) = 1.f;
+    return ip::EDGE_5X5_KERNEL.to_matrix();
   } else {
+    auto kernel = std::make_shared<Matrix<float>>(kernel_size, kernel_size);
     size_t kernel_semi_size = kernel_size / 2;
     float sigma = float(config.get_double(KERNEL_STD));
     float alpha = -1.f / (4.f * M_PI * std::pow(sigma, 4.f));
@@ -110,8 +393,8 @@ std::shared_ptr<Matrix<float>> EdgeDetectionProcessor::create_kernel(Configurati
         kernel->operator()(x, y) = alpha * (1.f - x2_y2_norm) * std::exp(-x2_y2_norm);
       }
     }
+    return kernel;
   }
-  return kernel;
 }
 
 bool EdgeDetectionProcessor::process(Context& context, std::string img_name, std::string output_img_name)
@@ -126,11 +409,29 @@ bool EdgeDetectionProcessor::process(Context& context, std::string img_name, std
 
   // Apply kernel
   auto kernel = create_kernel(config);
+  ip::BorderMode border_mode = get_border_mode(config);
   int kernel_size = config.get_int(KERNEL_SIZE);
   std::string algorithm = config.get_enum_value(EDGE_ALGORITHM);
+  bool fixed_point = config.get_bool(SF_FIXED_POINT);
   printf("Algorithm name %s\n", algorithm.c_str());
   printf("Kernel size %d\n", kernel_size);
-  if (img.type == ImageType::RGBA || img.type == ImageType::FULL) {
+  if (img.type == ImageType::PLANAR) {
+    // Morphological gradients only exist for packed images
+    if (algorithm != EDGE_KERNEL_ALGORITHM) {
+      return false;
+    }
+    auto res_img = std::make_shared<PlanarImage>(img.planar_img->get_rows(), img.planar_img->get_cols());
+    apply_edge_kernel(img.planar_img, kernel, res_img, kernel_size, border_mode);
+    context.add_image(output_img_name, Image(res_img));
+  } else if (img.type == ImageType::GRAY16) {
+    // Morphological gradients only exist for 8 bits images
+    if (algorithm != EDGE_KERNEL_ALGORITHM) {
+      return false;
+    }
+    auto res_img = std::make_shared<Matrix<uint16_t>>(img.gray16_img->get_rows(), img.gray16_img->get_cols());
+    apply_edge_kernel(img.gray16_img, kernel, res_img, kernel_size, border_mode);
+    context.add_image(output_img_name, Image(res_img));
+  } else if (img.type == ImageType::RGBA || img.type == ImageType::FULL) {
     auto res_img = std::make_shared<Matrix<uint32_t>>(img.rgba_img->get_rows(), img.rgba_img->get_cols());
     if (algorithm == EDGE_MORPH_H_ALGORITHM) {
       printf("EDGE_MORPH_H_ALGORITHM\n");
@@ -138,8 +439,10 @@ bool EdgeDetectionProcessor::process(Context& context, std::string img_name, std
     } else if (algorithm == EDGE_MORPH_V_ALGORITHM) {
       printf("EDGE_MORPH_V_ALGORITHM\n");
       res_img = ip::apply_v_gradient(img.rgba_img, kernel_size);
+    } else if (fixed_point) {
+      ip::apply_kernel_fixed_point(img.rgba_img, kernel, res_img, border_mode);
     } else {
-      ip::apply_kernel(img.rgba_img, kernel, res_img);
+      apply_edge_kernel(img.rgba_img, kernel, res_img, kernel_size, border_mode);
     }
     context.add_image(output_img_name, Image(res_img));
   } else {
@@ -148,8 +451,10 @@ bool EdgeDetectionProcessor::process(Context& context, std::string img_name, std
       res_img = ip::apply_h_gradient(img.gray_img, kernel_size);
     } else if (algorithm == EDGE_MORPH_V_ALGORITHM) {
       res_img = ip::apply_v_gradient(img.gray_img, kernel_size);
+    } else if (fixed_point) {
+      ip::apply_kernel_fixed_point(img.gray_img, kernel, res_img, border_mode);
     } else {
-      ip::apply_kernel(img.gray_img, kernel, res_img);
+      apply_edge_kernel(img.gray_img, kernel, res_img, kernel_size, border_mode);
     }
     context.add_image(output_img_name, Image(res_img));
   }
@@ -0,0 +1,84 @@
+#include "utils/cpu_features.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace utils {
+namespace {
+#if defined(__x86_64__) || defined(__i386__)
+// Register state saved by the OS on context switches (XCR0), wide registers are useless if they are not saved
+uint64_t read_xcr0()
+{
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (uint64_t(edx) << 32) | eax;
+}
+
+SimdLevel detect_simd_level()
+{
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1)) {
+    return SimdLevel::SCALAR;
+  }
+  bool avx_os = (ecx & bit_OSXSAVE) && (ecx & bit_AVX) && (read_xcr0() & 0x6) == 0x6;
+  if (!avx_os || !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & bit_AVX2)) {
+    return SimdLevel::SSE41;
+  }
+  // Opmask and upper ZMM states on top of XMM and YMM
+  bool avx512_os = (read_xcr0() & 0xe6) == 0xe6;
+  if (!avx512_os || !(ebx & bit_AVX512F) || !(ebx & bit_AVX512BW)) {
+    return SimdLevel::AVX2;
+  }
+  return SimdLevel::AVX512;
+}
+#else
+SimdLevel detect_simd_level()
+{
+  return SimdLevel::SCALAR;
+}
+#endif
+
+SimdLevel parse_simd_level(const char* name, SimdLevel default_level)
+{
+  for (SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+    if (std::strcmp(name, get_simd_level_name(level)) == 0) {
+      return level;
+    }
+  }
+  return default_level;
+}
+}
+
+SimdLevel get_simd_level()
+{
+  static const SimdLevel level = [] {
+    SimdLevel detected_level = detect_simd_level();
+    if (const char* env_level = std::getenv("CVUI_SIMD")) {
+      SimdLevel requested_level = parse_simd_level(env_level, detected_level);
+      return requested_level < detected_level ? requested_level : detected_level;
+    }
+    return detected_level;
+  }();
+  return level;
+}
+
+const char* get_simd_level_name(SimdLevel level)
+{
+  switch (level) {
+    case SimdLevel::SSE41:
+      return "sse4.1";
+    case SimdLevel::AVX2:
+      return "avx2";
+    case SimdLevel::AVX512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+}
\ No newline at end of file
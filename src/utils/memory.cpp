@@ -0,0 +1,310 @@
+#include "utils/memory.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace utils {
+namespace {
+// Buffers obtained from mmap, they have to be given back with munmap
+class MappedBuffers
+{
+public:
+  void add(void* ptr)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffers.insert(ptr);
+  };
+
+  bool remove(void* ptr)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return buffers.erase(ptr) > 0;
+  };
+
+private:
+  std::mutex mutex;
+  std::unordered_set<void*> buffers;
+};
+
+MappedBuffers& get_mapped_buffers()
+{
+  static MappedBuffers* mapped_buffers = new MappedBuffers();
+  return *mapped_buffers;
+}
+
+std::mutex policy_mutex;
+
+AllocationPolicy& get_policy()
+{
+  static AllocationPolicy policy = [] {
+    AllocationPolicy env_policy;
+    if (const char* threshold = std::getenv("CVUI_HUGE_PAGE_THRESHOLD")) {
+      env_policy.huge_page_threshold = std::strtoull(threshold, nullptr, 10);
+    }
+    if (const char* prefault = std::getenv("CVUI_PREFAULT")) {
+      env_policy.prefault = std::atoi(prefault) != 0;
+    }
+    return env_policy;
+  }();
+  return policy;
+}
+
+size_t round_to_huge_pages(size_t bytes)
+{
+  return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+#if defined(__linux__)
+void prefault_pages(void* ptr, size_t bytes)
+{
+#ifdef MADV_POPULATE_WRITE
+  if (madvise(ptr, bytes, MADV_POPULATE_WRITE) == 0) {
+    return;
+  }
+#endif
+  // Older kernels, touch one byte per page (the content of a new buffer is unspecified anyway)
+  size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+  volatile char* bytes_ptr = static_cast<char*>(ptr);
+  for (size_t offset = 0; offset < bytes; offset += page_size) {
+    bytes_ptr[offset] = 0;
+  }
+}
+
+// Map a huge page aligned block, nullptr on failure
+void* map_huge_pages(size_t bytes, bool prefault)
+{
+  size_t mapped_bytes = round_to_huge_pages(bytes);
+  // Over-allocate by one huge page so that the start can be aligned on a huge page boundary
+  size_t reserved_bytes = mapped_bytes + HUGE_PAGE_SIZE;
+  void* reserved = mmap(nullptr, reserved_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reserved == MAP_FAILED) {
+    return nullptr;
+  }
+
+  char* reserved_start = static_cast<char*>(reserved);
+  char* start = reserved_start + (HUGE_PAGE_SIZE - reinterpret_cast<uintptr_t>(reserved) % HUGE_PAGE_SIZE);
+  if (start - reserved_start == HUGE_PAGE_SIZE) {
+    start = reserved_start;
+  }
+  if (start > reserved_start) {
+    munmap(reserved_start, start - reserved_start);
+  }
+  size_t tail_bytes = reserved_start + reserved_bytes - (start + mapped_bytes);
+  if (tail_bytes > 0) {
+    munmap(start + mapped_bytes, tail_bytes);
+  }
+
+#ifdef MADV_HUGEPAGE
+  madvise(start, mapped_bytes, MADV_HUGEPAGE);
+#endif
+  if (prefault) {
+    prefault_pages(start, mapped_bytes);
+  }
+  return start;
+}
+#endif
+
+// Allocate a block straight from the system, bytes being a size class
+void* system_allocate(size_t bytes)
+{
+#if defined(__linux__)
+  AllocationPolicy policy = get_allocation_policy();
+  if (policy.huge_page_threshold != 0 && bytes >= policy.huge_page_threshold) {
+    void* ptr = map_huge_pages(bytes, policy.prefault);
+    if (ptr) {
+      get_mapped_buffers().add(ptr);
+      return ptr;
+    }
+    // Fall back on the regular allocator
+  }
+#endif
+
+  void* ptr = std::aligned_alloc(MEMORY_ALIGNMENT, bytes);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void system_release(void* ptr, size_t bytes)
+{
+#if defined(__linux__)
+  if (get_mapped_buffers().remove(ptr)) {
+    munmap(ptr, round_to_huge_pages(bytes));
+    return;
+  }
+#endif
+  std::free(ptr);
+}
+
+class BufferPool
+{
+public:
+  void* acquire(size_t class_bytes)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = free_buffers.find(class_bytes);
+    if (it == free_buffers.end() || it->second.empty()) {
+      return nullptr;
+    }
+    void* ptr = it->second.back();
+    it->second.pop_back();
+    cached_bytes -= class_bytes;
+    return ptr;
+  };
+
+  // Returns false if the pool is full, the caller then has to free the buffer
+  bool recycle(void* ptr, size_t class_bytes)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cached_bytes + class_bytes > capacity) {
+      return false;
+    }
+    free_buffers[class_bytes].push_back(ptr);
+    cached_bytes += class_bytes;
+    return true;
+  };
+
+  void set_capacity(size_t bytes)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = bytes;
+    trim_to_capacity();
+  };
+
+  void trim()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t saved_capacity = capacity;
+    capacity = 0;
+    trim_to_capacity();
+    capacity = saved_capacity;
+  };
+
+  size_t get_cached_bytes()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cached_bytes;
+  };
+
+private:
+  void trim_to_capacity()
+  {
+    for (auto& it : free_buffers) {
+      while (cached_bytes > capacity && !it.second.empty()) {
+        system_release(it.second.back(), it.first);
+        it.second.pop_back();
+        cached_bytes -= it.first;
+      }
+    }
+  };
+
+  std::mutex mutex;
+  std::unordered_map<size_t, std::vector<void*>> free_buffers;
+  size_t cached_bytes = 0;
+  size_t capacity = DEFAULT_POOL_CAPACITY;
+};
+
+// Never destroyed, matrices owned by static objects may be released after the end of main
+BufferPool& get_pool()
+{
+  static BufferPool* pool = new BufferPool();
+  return *pool;
+}
+
+// Actual size of the block backing a buffer of the given size
+size_t size_class(size_t bytes)
+{
+  // std::aligned_alloc requires the size to be a multiple of the alignment
+  size_t aligned_bytes = (bytes + MEMORY_ALIGNMENT - 1) / MEMORY_ALIGNMENT * MEMORY_ALIGNMENT;
+  if (aligned_bytes < POOL_MIN_BYTES) {
+    return aligned_bytes;
+  }
+
+  size_t power_of_two = POOL_MIN_BYTES;
+  while (power_of_two <= aligned_bytes / 2) {
+    power_of_two *= 2;
+  }
+  size_t step = power_of_two / 4;
+  return (aligned_bytes + step - 1) / step * step;
+}
+}
+
+void* aligned_allocate(size_t bytes)
+{
+  if (bytes == 0) {
+    return nullptr;
+  }
+
+  size_t class_bytes = size_class(bytes);
+  if (class_bytes >= POOL_MIN_BYTES) {
+    void* ptr = get_pool().acquire(class_bytes);
+    if (ptr) {
+      return ptr;
+    }
+  }
+
+  return system_allocate(class_bytes);
+}
+
+void aligned_release(void* ptr, size_t bytes)
+{
+  if (!ptr) {
+    return;
+  }
+
+  size_t class_bytes = size_class(bytes);
+  if (class_bytes >= POOL_MIN_BYTES && get_pool().recycle(ptr, class_bytes)) {
+    return;
+  }
+  system_release(ptr, class_bytes);
+}
+
+void set_allocation_policy(const AllocationPolicy& policy)
+{
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  get_policy() = policy;
+}
+
+AllocationPolicy get_allocation_policy()
+{
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  return get_policy();
+}
+
+void set_buffer_pool_capacity(size_t bytes)
+{
+  get_pool().set_capacity(bytes);
+}
+
+size_t get_buffer_pool_cached_bytes()
+{
+  return get_pool().get_cached_bytes();
+}
+
+void trim_buffer_pool()
+{
+  get_pool().trim();
+}
+
+size_t aligned_stride(size_t cols, size_t element_size)
+{
+  size_t row_bytes = cols * element_size;
+  size_t aligned_row_bytes = (row_bytes + MEMORY_ALIGNMENT - 1) / MEMORY_ALIGNMENT * MEMORY_ALIGNMENT;
+  if (aligned_row_bytes % element_size != 0) {
+    // Element size does not divide the alignment, keep a dense layout
+    return cols;
+  }
+  return aligned_row_bytes / element_size;
+}
+}
\ No newline at end of file
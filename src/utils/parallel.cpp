@@ -0,0 +1,111 @@
+#include "utils/parallel.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace utils {
+namespace {
+// Set in worker threads and while the pool runs a job, nested jobs then run serially
+thread_local bool inside_pool = false;
+}
+
+ThreadPool::ThreadPool(size_t n_threads)
+{
+  for (size_t i = 1; i < n_threads; ++i) {
+    workers.emplace_back(&ThreadPool::worker_loop, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake_condition.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::run(size_t n_tasks, const std::function<void(size_t)>& task)
+{
+  std::unique_lock<std::mutex> run_lock(run_mutex, std::try_to_lock);
+  if (inside_pool || !run_lock.owns_lock() || workers.empty() || n_tasks <= 1) {
+    for (size_t index = 0; index < n_tasks; ++index) {
+      task(index);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job = &task;
+    job_size = n_tasks;
+    next_task = 0;
+    pending_workers = workers.size();
+    ++generation;
+  }
+  wake_condition.notify_all();
+
+  inside_pool = true;
+  execute_tasks();
+  inside_pool = false;
+
+  // Every worker has to be done with the job before it goes out of scope
+  std::unique_lock<std::mutex> lock(mutex);
+  done_condition.wait(lock, [this] { return pending_workers == 0; });
+  job = nullptr;
+}
+
+void ThreadPool::worker_loop()
+{
+  inside_pool = true;
+  uint64_t seen_generation = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wake_condition.wait(lock, [this, seen_generation] { return stopping || generation != seen_generation; });
+    if (stopping) {
+      return;
+    }
+    seen_generation = generation;
+
+    lock.unlock();
+    execute_tasks();
+    lock.lock();
+
+    if (--pending_workers == 0) {
+      done_condition.notify_one();
+    }
+  }
+}
+
+void ThreadPool::execute_tasks()
+{
+  for (size_t index = next_task++; index < job_size; index = next_task++) {
+    (*job)(index);
+  }
+}
+
+ThreadPool& get_thread_pool()
+{
+  // Never destroyed, avoids joining threads during static destruction
+  static ThreadPool* pool = [] {
+    size_t n_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (const char* env_threads = std::getenv("CVUI_NUM_THREADS")) {
+      n_threads = std::max(1, std::atoi(env_threads));
+    }
+    return new ThreadPool(n_threads);
+  }();
+  return *pool;
+}
+
+void parallel_for(size_t rows, const std::function<void(size_t, size_t)>& body, size_t grain)
+{
+  grain = std::max(size_t(1), grain);
+  size_t n_bands = (rows + grain - 1) / grain;
+  get_thread_pool().run(n_bands, [&body, rows, grain](size_t band) {
+    body(band * grain, std::min(rows, (band + 1) * grain));
+  });
+}
+}
\ No newline at end of file